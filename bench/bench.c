@@ -0,0 +1,407 @@
+// Benchmarks of the core game paths on generated levels of growing size.
+// Runs inside a scratch directory and prints one JSON line per case to stdout:
+// {"revision":"..","bench":"loadGame","input":"w101r4 parse","size":40804,"iterations":9,"ops":9,"seconds":0.25,"ns_per_op":..}
+// size is level cells, or save files for fetchLocalData. Errors go to stderr.
+#ifndef _WIN32
+#define _DEFAULT_SOURCE
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "game.h"
+#include "level.h"
+#include "generate.h"
+#include "render.h"
+#include "replay.h"
+#include "savesdir.h"
+#include "levelcache.h"
+#include "binio.h"
+#include "loglib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#define chdir _chdir
+#define NULL_DEVICE "NUL"
+#else
+#include <unistd.h>
+#define NULL_DEVICE "/dev/null"
+#endif
+
+#define BENCH_DEFAULT_SECONDS 0.25 // each case repeats until it ran at least this long
+#define BENCH_MAX_ITERATIONS 100000
+#define BENCH_ROOMS 4
+#define BENCH_WALK_MOVES (1 << 18) // moves of one playMove iteration, also saved for replay
+#define BENCH_STEP_FRAMES 64        // frames of one incremental renderGame iteration
+#define BENCH_SAVE_MOVES 256        // moves in each save of the fetchLocalData trees
+
+static const int benchWidths[] = { 21, 101, 301, 1001 };
+static const int benchTrees[][2] = { { 4, 16 }, { 16, 64 }, { 32, 256 } }; // levels, saves per level
+
+static const char *revision = "unknown";
+static double minSeconds = BENCH_DEFAULT_SECONDS;
+
+// Untimed preparation and timed work of a case, run returns operations done or -1
+typedef int (*BenchSetup)(void *context);
+typedef long long (*BenchRun)(void *context);
+
+typedef struct {
+    const char *name;
+    char input[64];
+    long long size;
+    int muted; // stdout goes to NULL_DEVICE while timed
+} BenchCase;
+
+static double benchNow(void) {
+#ifdef _WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+#endif
+}
+
+// Internal: point stdout at NULL_DEVICE, returns the descriptor to restore or -1.
+static int muteStdout(void) {
+    fflush(stdout);
+    int saved = dup(fileno(stdout));
+    if (saved < 0) return -1;
+    if (!freopen(NULL_DEVICE, "w", stdout)) {
+        close(saved);
+        return -1;
+    }
+    return saved;
+}
+
+static void restoreStdout(int saved) {
+    if (saved < 0) return;
+    fflush(stdout);
+    dup2(saved, fileno(stdout));
+    close(saved);
+    clearerr(stdout);
+}
+
+// Repeat a case until it ran minSeconds, then print its result line. Returns 0 on failure.
+static int runCase(const BenchCase *bench, BenchSetup setup, BenchRun run, void *context) {
+    double seconds = 0;
+    long long ops = 0;
+    int iterations = 0;
+    while ((iterations == 0 || seconds < minSeconds) && iterations < BENCH_MAX_ITERATIONS) {
+        if (setup && !setup(context)) {
+            fprintf(stderr, "%s (%s): setup failed\n", bench->name, bench->input);
+            return 0;
+        }
+        int saved = bench->muted ? muteStdout() : -1;
+        double started = benchNow();
+        long long done = run(context);
+        seconds += benchNow() - started;
+        restoreStdout(saved);
+        if (done < 0) {
+            fprintf(stderr, "%s (%s): failed\n", bench->name, bench->input);
+            return 0;
+        }
+        ops += done;
+        iterations++;
+    }
+    printf("{\"revision\":\"%s\",\"bench\":\"%s\",\"input\":\"%s\",\"size\":%lld,\"iterations\":%d,\"ops\":%lld,\"seconds\":%.6f,\"ns_per_op\":%.1f}\n",
+        revision, bench->name, bench->input, bench->size, iterations, ops, seconds, ops ? seconds * 1e9 / (double)ops : 0.0);
+    fflush(stdout);
+    return 1;
+}
+
+// Level cases, one generated level per width
+
+typedef struct {
+    char name[32];
+    char path[128];
+    char savePath[256];
+    GeneratorOptions options;
+    char *walk;     // moves of the first walk, replayed by the incremental frames
+    int walkCount;
+} LevelBench;
+
+static long long runGenerate(void *context) {
+    LevelBench *bench = (LevelBench*)context;
+    FILE *file = fopen(bench->path, "wb");
+    if (!file) return -1;
+    int ok = generateLevel(file, &bench->options);
+    return (fclose(file) == 0 && ok) ? 1 : -1;
+}
+
+static int setupParse(void *context) {
+    LevelBench *bench = (LevelBench*)context;
+    char cachePath[256];
+    snprintf(cachePath, sizeof(cachePath), LEVEL_CACHE_FOLDER"/%s.lvl", bench->name);
+    unloadGame();
+    remove(cachePath); // next load parses the source and compiles it again
+    return 1;
+}
+
+static int setupCached(void *context) {
+    (void)context;
+    unloadGame();
+    return 1;
+}
+
+static long long runLoad(void *context) {
+    LevelBench *bench = (LevelBench*)context;
+    return loadGame(bench->name) ? 1 : -1;
+}
+
+static int setupRestart(void *context) {
+    (void)context;
+    return restartGame();
+}
+
+// Right hand rule walk through the loaded level, moves go through playMove() the
+// same way as in the game loop. Closed doors count as walls.
+static long long runWalk(void *context) {
+    (void)context;
+    static const char turns[4] = { 'w', 'd', 's', 'a' }; // clockwise
+    int facing = 0;
+    int moves = 0;
+    while (moves < BENCH_WALK_MOVES) {
+        int moved = 0;
+        for (int t = 1; t <= 4 && !moved; t++) { // right, ahead, left, back
+            int direction = (facing + t) % 4;
+            if (!playMove(turns[direction])) {
+                facing = direction;
+                moved = 1;
+            }
+        }
+        if (!moved) break; // walled in
+        moves++;
+    }
+    return moves;
+}
+
+// Same work as loadMoves(), without its logging and progress output
+static long long runReplay(void *context) {
+    LevelBench *bench = (LevelBench*)context;
+    SaveView view;
+    if (!openSaveView(bench->savePath, &view)) return -1;
+    ReplayResult result;
+    int ok = replaySave(&view, NULL, &result);
+    freeReplayResult(&result);
+    long long count = view.count;
+    closeSaveView(&view);
+    return ok ? count : -1;
+}
+
+static long long runFullFrame(void *context) {
+    (void)context;
+    renderInvalidate();
+    renderGame(&level, game.playerR, game.playerY, game.playerX, movesMade, game.victory);
+    return 1;
+}
+
+static int setupSteps(void *context) {
+    (void)context;
+    if (!restartGame()) return 0;
+    renderInvalidate();
+    int saved = muteStdout();
+    renderGame(&level, game.playerR, game.playerY, game.playerX, movesMade, game.victory); // first frame is full
+    restoreStdout(saved);
+    return 1;
+}
+
+// Frames after single moves, only the cells that changed are sent
+static long long runSteps(void *context) {
+    LevelBench *bench = (LevelBench*)context;
+    int frames = bench->walkCount < BENCH_STEP_FRAMES ? bench->walkCount : BENCH_STEP_FRAMES;
+    for (int i = 0; i < frames; i++) {
+        playMove(bench->walk[i]);
+        renderGame(&level, game.playerR, game.playerY, game.playerX, movesMade, game.victory);
+    }
+    return frames;
+}
+
+// Internal: keep the moves of the last walk and save them for the replay case.
+static int keepWalk(LevelBench *bench) {
+    bench->walkCount = movesMade;
+    bench->walk = (char*)malloc(movesMade ? movesMade : 1);
+    if (!bench->walk) return 0;
+    memcpy(bench->walk, moveSequence, movesMade);
+    char dirPath[128];
+    snprintf(dirPath, sizeof(dirPath), GAMES_FOLDER"/%s/"ONGOING_FOLDER, bench->name);
+    snprintf(bench->savePath, sizeof(bench->savePath), "%s/bench.bin", dirPath);
+    createDirectories(dirPath);
+    return saveData(bench->savePath, movesMade, moveSequence, loadedLevelHash);
+}
+
+static int benchLevel(int width) {
+    LevelBench bench;
+    memset(&bench, 0, sizeof(bench));
+    snprintf(bench.name, sizeof(bench.name), "w%d", width);
+    snprintf(bench.path, sizeof(bench.path), LEVELS_FOLDER"/%s.dat", bench.name);
+    defaultGeneratorOptions(&bench.options);
+    bench.options.width = width;
+    bench.options.roomCount = BENCH_ROOMS;
+
+    BenchCase cases[7];
+    memset(cases, 0, sizeof(cases));
+    const char *names[7] = { "generateLevel", "loadGame", "loadGame", "playMove", "replaySave", "renderGame", "renderGame" };
+    const char *variants[7] = { "", " parse", " cached", "", "", " full", " step" };
+    for (int c = 0; c < 7; c++) {
+        cases[c].name = names[c];
+        snprintf(cases[c].input, sizeof(cases[c].input), "w%dr%d%s", width, BENCH_ROOMS, variants[c]);
+        cases[c].size = (long long)width * width * BENCH_ROOMS;
+        cases[c].muted = c >= 5;
+    }
+
+    int ok = runCase(&cases[0], NULL, runGenerate, &bench)
+        && runCase(&cases[1], setupParse, runLoad, &bench)
+        && runCase(&cases[2], setupCached, runLoad, &bench)
+        && runCase(&cases[3], setupRestart, runWalk, &bench)
+        && keepWalk(&bench)
+        && runCase(&cases[4], setupRestart, runReplay, &bench)
+        && runCase(&cases[5], NULL, runFullFrame, &bench)
+        && runCase(&cases[6], setupSteps, runSteps, &bench);
+    unloadGame();
+    free(bench.walk);
+    return ok;
+}
+
+// Save tree cases, levels with finished and ongoing saves in a directory of their own
+
+typedef struct {
+    int levels;
+    int saves; // per level, half finished and half ongoing
+} TreeBench;
+
+static int setupUnindexed(void *context) {
+    TreeBench *tree = (TreeBench*)context;
+    freeLocalData();
+    for (int l = 0; l < tree->levels; l++) {
+        char path[256];
+        snprintf(path, sizeof(path), GAMES_FOLDER"/t%d/"FINISHED_FOLDER"/"SAVE_INDEX_FILE, l);
+        remove(path);
+        snprintf(path, sizeof(path), GAMES_FOLDER"/t%d/"ONGOING_FOLDER"/"SAVE_INDEX_FILE, l);
+        remove(path);
+    }
+    return 1;
+}
+
+static int setupIndexed(void *context) {
+    (void)context;
+    freeLocalData();
+    return 1;
+}
+
+static long long runFetch(void *context) {
+    TreeBench *tree = (TreeBench*)context;
+    fetchLocalData();
+    return levelCount == tree->levels ? 1 : -1;
+}
+
+// Internal: fill the current directory with the tree. Saves are copies of one file
+// written with plain writes, saveData() would sync every one of them.
+static int buildTree(const TreeBench *tree) {
+    char moves[BENCH_SAVE_MOVES];
+    for (int i = 0; i < BENCH_SAVE_MOVES; i++) moves[i] = "wasd"[i % 4];
+    const char *templatePath = "saves/template.bin";
+    if (!saveData(templatePath, BENCH_SAVE_MOVES, moves, 0)) return 0;
+    FILE *file = fopen(templatePath, "rb");
+    if (!file) return 0;
+    unsigned char buffer[SAVE_HEADER_SIZE + BENCH_SAVE_MOVES];
+    size_t size = fread(buffer, 1, sizeof(buffer), file);
+    fclose(file);
+
+    createDirectories(LEVELS_FOLDER);
+    for (int l = 0; l < tree->levels; l++) {
+        char path[256];
+        snprintf(path, sizeof(path), LEVELS_FOLDER"/t%d.dat", l);
+        file = fopen(path, "wb");
+        if (!file) return 0;
+        fputs("WIDTH 5\n\nBEGIN\n#####\n#@ $#\n#   #\n#   #\n#####\nEND\n", file);
+        fclose(file);
+        for (int s = 0; s < tree->saves; s++) {
+            const char *folder = s % 2 ? ONGOING_FOLDER : FINISHED_FOLDER;
+            snprintf(path, sizeof(path), GAMES_FOLDER"/t%d/%s", l, folder);
+            createDirectories(path);
+            snprintf(path, sizeof(path), GAMES_FOLDER"/t%d/%s/player%d.bin", l, folder, s / 2);
+            file = fopen(path, "wb");
+            if (!file) return 0;
+            int written = fwrite(buffer, 1, size, file) == size;
+            if (fclose(file) != 0 || !written) return 0;
+        }
+    }
+    return 1;
+}
+
+static int benchTree(int levels, int saves) {
+    TreeBench tree = { levels, saves };
+    char dirPath[64];
+    snprintf(dirPath, sizeof(dirPath), "tree%dx%d", levels, saves);
+    createDirectories(dirPath);
+    if (chdir(dirPath) != 0) {
+        fprintf(stderr, "Failed to enter '%s'.\n", dirPath);
+        return 0;
+    }
+    forgetDirectories(); // remembered paths are relative
+    int ok = buildTree(&tree);
+    if (!ok) fprintf(stderr, "Failed to build save tree '%s'.\n", dirPath);
+
+    BenchCase unindexed = { "fetchLocalData", "", (long long)levels * saves, 0 };
+    BenchCase indexed = unindexed;
+    snprintf(unindexed.input, sizeof(unindexed.input), "%d levels x %d saves unindexed", levels, saves);
+    snprintf(indexed.input, sizeof(indexed.input), "%d levels x %d saves indexed", levels, saves);
+    ok = ok
+        && runCase(&unindexed, setupUnindexed, runFetch, &tree)
+        && runCase(&indexed, setupIndexed, runFetch, &tree);
+    freeLocalData();
+    forgetDirectories();
+    if (chdir("..") != 0) return 0;
+    return ok;
+}
+
+// bench.out [-d dir] [-t seconds] [-w max width] [-r revision]
+// Levels and saves are made in dir (default "bench-work"), which is kept for the next run.
+int main(int argc, char **argv) {
+    const char *workDir = "bench-work";
+    int maxWidth = benchWidths[sizeof(benchWidths) / sizeof(benchWidths[0]) - 1];
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 < argc && strcmp(argv[i], "-d") == 0) {
+            workDir = argv[++i];
+        } else if (i + 1 < argc && strcmp(argv[i], "-t") == 0) {
+            minSeconds = atof(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-w") == 0) {
+            maxWidth = atoi(argv[++i]);
+        } else if (i + 1 < argc && strcmp(argv[i], "-r") == 0) {
+            revision = argv[++i];
+        } else {
+            fprintf(stderr, "Usage: %s [-d dir] [-t seconds] [-w max width] [-r revision]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    // Logging would be measured too, and nothing is read back from it
+    log_set_level(LOGLIB_LEVEL_NONE);
+
+    createDirectories(workDir);
+    if (chdir(workDir) != 0) {
+        fprintf(stderr, "Failed to enter '%s'.\n", workDir);
+        return 1;
+    }
+    forgetDirectories();
+    createDirectories(LEVELS_FOLDER);
+
+    int ok = 1;
+    for (size_t i = 0; ok && i < sizeof(benchWidths) / sizeof(benchWidths[0]); i++) {
+        if (benchWidths[i] <= maxWidth) ok = benchLevel(benchWidths[i]);
+    }
+    for (size_t i = 0; ok && i < sizeof(benchTrees) / sizeof(benchTrees[0]); i++) {
+        ok = benchTree(benchTrees[i][0], benchTrees[i][1]);
+    }
+
+    freeRenderer();
+    forgetDirectories();
+    return ok ? 0 : 1;
+}
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <stdint.h>
 #include "loglib.h"
 #ifdef _WIN32
 #include <direct.h>
@@ -14,11 +15,83 @@
 #define DIR_SEP "/"
 #endif
 
+// Save file: 16 byte header, then moves in one of the encodings
+//   0  magic "CMZS"       4  version        5  encoding     6  reserved (2)
+//   8  move count (u32)   12 level hash (u32), integers little endian
+// Files without the magic are legacy saves: native int count, one char per move
+#define SAVE_MAGIC "CMZS"
+#define SAVE_JOURNAL_MAGIC "CMZJ" // same header with count 0, followed by raw moves until end of file
+#define SAVE_VERSION 2
+#define SAVE_HEADER_SIZE 16
+#define SAVE_ENCODING_RAW 0     // one char per move, for moves other than w/a/s/d
+#define SAVE_ENCODING_PACKED 1  // 2 bits per move, 4 moves per byte
+#define SAVE_ENCODING_RLE 2     // one byte per run of equal moves
+#define SAVE_RLE_MAX_RUN 64
+#define SAVE_MAX_MOVES 0x7FFFFFFF
+
+// FNV-1a
+#define HASH_SEED 2166136261u
+
+// Read-only view over a save file mapped into memory
+typedef struct {
+    const unsigned char *bytes;   // whole file
+    size_t size;
+    int count;                    // moves stored
+    int encoding;                 // SAVE_ENCODING_*, legacy saves are raw
+    uint32_t levelHash;           // 0 for legacy saves
+    const unsigned char *payload; // encoded moves
+    size_t payloadSize;
+#ifdef _WIN32
+    void *fileHandle;
+    void *mappingHandle;
+#endif
+} SaveView;
+
+// Reads moves of a SaveView front to back
+typedef struct {
+    const SaveView *view;
+    int index;      // moves read so far
+    size_t offset;  // next payload byte of RLE saves
+    int runLeft;    // moves left in current run
+    char runMove;
+} SaveCursor;
+
+// Per directory index of save files and their move counts, hidden from listings
+#define SAVE_INDEX_FILE ".index"
+
+typedef struct {
+    char *name;   // file name inside the directory
+    int count;    // moves stored in the file
+} SaveIndexEntry;
+
+// Also fsync the directory after a save is renamed into place: 1 on, 0 off,
+// -1 (default) until read from the CONMAZE_SYNC_DIR environment variable on first save
+extern int saveSyncDirectory;
+
 // Function declarations
 void createDirectories(const char *path);
+void forgetDirectories(void);
+int writeFileAtomic(const char *path, const void *bytes, size_t size);
+int syncFile(FILE *file);
+int truncateFile(FILE *file, long size);
+int writeJournalHeader(FILE *file, uint32_t levelHash);
 int findData(const char *path);
-int saveData(const char *path, int count, const char *data);
-int loadData(const char *path, int *out_count, char **out_data);
+uint32_t hashData(uint32_t hash, const void *data, size_t size);
+int hashFile(const char *path, uint32_t *out_hash);
+int saveData(const char *path, int count, const char *data, uint32_t levelHash);
+int peekData(const char *path, int *out_count);
+int openSaveView(const char *path, SaveView *view);
+void closeSaveView(SaveView *view);
+void startSaveCursor(SaveCursor *cursor, const SaveView *view);
+int readSaveMoves(SaveCursor *cursor, char *out, int max);
+char saveMoveAt(const SaveView *view, int index);
 int deleteData(const char *path);
 
+int isSaveIndexFresh(const char *dirPath);
+int readSaveIndex(const char *dirPath, SaveIndexEntry **out_entries, int *out_count);
+int writeSaveIndex(const char *dirPath, const SaveIndexEntry *entries, int count);
+int appendSaveIndex(const char *dirPath, const char *name, int count);
+const SaveIndexEntry *findSaveIndex(const SaveIndexEntry *entries, int count, const char *name);
+void freeSaveIndex(SaveIndexEntry *entries, int count);
+
 #endif // BINIO_H
@@ -0,0 +1,53 @@
+#ifndef GAME_H
+#define GAME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "level.h"
+#include "gamestate.h"
+
+// Smallest allocation of the move sequence, it then doubles as needed
+#define MOVE_BUFFER_MIN 64
+
+// Mutable part of a running game, level layout and indexes are shared
+typedef struct {
+    char *tiles;
+    int *meta;
+    unsigned char *special;
+    int playerX;
+    int playerY;
+    int playerR;
+    int movesMade;
+    int victory;
+} GameSnapshot;
+
+// Game state variables
+extern int isGameLoaded;
+extern char* loadedLevelName;
+extern uint32_t loadedLevelHash;
+extern Level level;
+extern GameState game;
+extern int movesMade;
+extern char *moveSequence;
+
+// Game state flags
+extern int loading;
+
+// Function declarations
+void parseLevelName(const char *arg, char *out, size_t size);
+int loadGame(char* levelFile);
+void unloadGame(void);
+int restartGame(void);
+int startGameState(GameState *state);
+int takeSnapshot(GameSnapshot *snapshot);
+void restoreSnapshot(const GameSnapshot *snapshot);
+void freeSnapshot(GameSnapshot *snapshot);
+void clearHistory(void);
+int playMove(char input);
+int undoMove(void);
+int redoMove(void);
+int reserveMoves(int capacity);
+void addMoveToSequence(char move);
+void addMovesToSequence(const char *moves, int count);
+
+#endif // GAME_H
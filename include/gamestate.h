@@ -0,0 +1,51 @@
+#ifndef GAMESTATE_H
+#define GAMESTATE_H
+
+#include <stddef.h>
+#include "level.h"
+
+// What a step did, several can be set at once
+#define GAME_EVENT_MOVED    0x01 // player went to the next cell
+#define GAME_EVENT_BLOCKED  0x02 // wall, closed door, edge of room or not a move, nothing changed
+#define GAME_EVENT_KEY      0x04 // key picked up
+#define GAME_EVENT_DOOR     0x08 // doors of the key opened
+#define GAME_EVENT_PASSAGE  0x10 // player was sent to the other end of a passage
+#define GAME_EVENT_FLAGGED  0x20 // passage without other end, now marked as error
+#define GAME_EVENT_VICTORY  0x40 // goal reached
+
+typedef struct {
+    int flags;       // GAME_EVENT_*
+    int id;          // id of the key or passage, -1 if none
+    int doorsOpened;
+} GameEvents;
+
+// Called before a step changes metadata of a cell, clearSpecial when its special bit goes too
+typedef void (*GameChangeHook)(void *context, size_t cell, int meta, int clearSpecial);
+
+// One game on a level. Tiles and id indexes of the level are only read, so any
+// number of states can play the same level at once, each on its own thread.
+typedef struct {
+    const Level *level;
+    int *meta;              // -1 once a key or door is used up, -2 once flagged
+    unsigned char *special; // bit per cell, same layout as in Level
+    int ownsCells;          // meta and special are copies freed with the state
+    int playerX;
+    int playerY;
+    int playerR;
+    int victory;
+    GameChangeHook onChange; // optional, e.g. undo history
+    void *changeContext;
+} GameState;
+
+#define GAME_SPECIAL(state, i) (((state)->special[(i) >> 3] >> ((i) & 7)) & 1)
+
+// Function declarations
+int initGameState(GameState *state, const Level *level, int startR, int startY, int startX);
+void bindGameState(GameState *state, Level *level, int startR, int startY, int startX);
+void freeGameState(GameState *state);
+int canStep(const GameState *state, char move);
+GameEvents step(GameState *state, char move);
+int stepPlain(GameState *state, const char *moves, int count);
+int findPassageExit(const Level *level, int id, size_t from, size_t *out);
+
+#endif // GAMESTATE_H
@@ -0,0 +1,25 @@
+#ifndef GENERATE_H
+#define GENERATE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+// Smallest room that still has a corridor inside its walls
+#define GENERATE_MIN_WIDTH 5
+
+// Level generator settings, densities are fractions between 0 and 1
+typedef struct {
+    int width;
+    int roomCount;
+    double keyDensity;      // floor cells holding a key, at least one key per door id
+    double doorDensity;     // cells of the way to the exit that become doors
+    double passageDensity;  // floor cells that become ends of extra passages
+    uint64_t seed;
+} GeneratorOptions;
+
+// Function declarations
+void defaultGeneratorOptions(GeneratorOptions *options);
+int generateLevel(FILE *out, const GeneratorOptions *options);
+int generateCommand(int argc, char **argv);
+
+#endif // GENERATE_H
@@ -0,0 +1,25 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Autosave of the running game, GAMES_FOLDER/<level>/ONGOING_FOLDER/JOURNAL_FILE
+// Hidden from save listings, removed when the game ends normally
+#define JOURNAL_FILE ".journal"
+#define JOURNAL_KEPT_FILE ".journal.1" // crash journal moved aside when a new game of its level starts
+#define JOURNAL_FLUSH_MOVES 64   // moves kept in memory before they are written
+#define JOURNAL_SYNC_SECONDS 5   // fsync at most this often
+
+// Function declarations
+void journalPath(char *buf, size_t bufsz, const char *levelName);
+void keptJournalPath(char *buf, size_t bufsz, const char *levelName);
+int findJournal(const char *levelName);
+int startJournal(const char *levelName, uint32_t levelHash, const char *moves, int count, const char *resumedPath);
+void appendJournal(char move);
+void flushJournal(void);
+void truncateJournal(int count);
+void closeJournal(int discard);
+int isJournalOpen(void);
+
+#endif // JOURNAL_H
@@ -0,0 +1,20 @@
+#ifndef LEADERBOARD_H
+#define LEADERBOARD_H
+
+// Finished games shown per LEADERBOARD page
+#define LEADERBOARD_PAGE_SIZE 7 // plus page switches, keeps every option on a number key
+
+typedef struct {
+    const char *name; // owned by savesdir, valid until local data changes
+    int moves;        // -1 if save couldn't be read
+    int rank;         // 1 based, equal moves share a rank
+} LeaderboardEntry;
+
+// Function declarations
+int leaderboardCount(int levelIndex);
+int leaderboardPage(int levelIndex, int first, int count, LeaderboardEntry *out);
+int leaderboardTop(int levelIndex, int k, LeaderboardEntry *out);
+int leaderboardRank(int levelIndex, const char *playerName);
+void freeLeaderboards(void);
+
+#endif // LEADERBOARD_H
@@ -0,0 +1,76 @@
+#ifndef LEVEL_H
+#define LEVEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Symbols (chars)
+#define CHAR_WALL          '#'
+#define CHAR_DOOR          '&'
+#define CHAR_KEY           '!'
+#define CHAR_VOID          ' '
+#define CHAR_PASSAGE       '^'
+#define CHAR_START         '@'
+#define CHAR_GOAL          '$'
+#define HAS_METADATA(c) (c == CHAR_DOOR || c == CHAR_KEY || c == CHAR_PASSAGE)
+
+#define LEVEL_READ_BLOCK 65536 // bytes read from a level file at once
+
+// Tiles of one kind grouped by their id, built once at load time.
+// Cells of a group are flat level indexes in scan order (room, row, column).
+typedef struct {
+    int groupCount;
+    int *ids;       // id of each group
+    int *starts;    // offset of each group in cells
+    int *counts;    // number of cells in each group
+    size_t *cells;
+    int hashMask;   // hash table size - 1 (power of two)
+    int *hash;      // id -> group, -1 when slot is empty
+} IdIndex;
+
+// Whole level in two contiguous blocks, rooms are stored back to back.
+// Tile (r, y, x) lives at r*W*W + y*W + x in both arrays.
+typedef struct {
+    int width;
+    int roomCount;
+    char *tiles;
+    int *meta; // -1 means no id (or used up), -2 means flagged as error
+    unsigned char *special; // bit per tile, set where stepping on it can do something
+    IdIndex doors;
+    IdIndex keys;
+    IdIndex passages;
+} Level;
+
+#define LEVEL_INDEX(level, r, y, x) ((((size_t)(r) * (level)->width) + (size_t)(y)) * (level)->width + (size_t)(x))
+#define LEVEL_TILE(level, r, y, x) ((level)->tiles[LEVEL_INDEX(level, r, y, x)])
+#define LEVEL_META(level, r, y, x) ((level)->meta[LEVEL_INDEX(level, r, y, x)])
+#define LEVEL_SPECIAL(level, i) (((level)->special[(i) >> 3] >> ((i) & 7)) & 1)
+#define LEVEL_SET_SPECIAL(level, i) ((level)->special[(i) >> 3] |= (unsigned char)(1u << ((i) & 7)))
+#define LEVEL_CLEAR_SPECIAL(level, i) ((level)->special[(i) >> 3] &= (unsigned char)~(1u << ((i) & 7)))
+#define LEVEL_ROOM_SIZE(level) ((size_t)(level)->width * (level)->width)
+#define LEVEL_SIZE(level) ((size_t)(level)->roomCount * LEVEL_ROOM_SIZE(level))
+
+// Problems found in a level source, logged unless a sink is given
+#define LEVEL_DIAG_WARNING 1
+#define LEVEL_DIAG_ERROR 2
+
+// Called with each problem, line is 1-based or 0 when it is not tied to a line
+typedef void (*LevelDiagnosticSink)(void *context, int severity, int line, const char *message);
+
+typedef struct {
+    LevelDiagnosticSink report;
+    void *context;
+} LevelDiagnostics;
+
+// Function declarations
+int allocLevel(Level *level, int width, int roomCount);
+void freeLevel(Level *level);
+int buildLevelIndex(Level *level);
+void checkLevelIndex(const Level *level);
+int parseLevel(FILE *file, Level *level, int *startR, int *startY, int *startX, uint32_t *out_hash,
+    const LevelDiagnostics *diagnostics);
+int findIdGroupIndex(const IdIndex *index, int id);
+const size_t *findIdGroup(const IdIndex *index, int id, int *count);
+
+#endif // LEVEL_H
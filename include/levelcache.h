@@ -0,0 +1,25 @@
+#ifndef LEVELCACHE_H
+#define LEVELCACHE_H
+
+#include <stdint.h>
+#include "level.h"
+#include "savesdir.h"
+
+// Compiled levels, LEVEL_CACHE_FOLDER/<name>.lvl, hidden from level listing
+#define LEVEL_CACHE_FOLDER LEVELS_FOLDER"/.cache"
+#define LEVEL_CACHE_MAGIC "CMZL"
+#define LEVEL_CACHE_VERSION 1
+
+// Identity of a level source file, cache is valid while it matches
+typedef struct {
+    int64_t mtime;
+    int64_t size;
+    uint32_t hash; // hashFile of source, 0 until known
+} LevelSource;
+
+// Function declarations
+int statLevelSource(const char *path, LevelSource *source);
+int loadLevelCache(const char *levelName, const char *sourcePath, LevelSource *source, Level *level, int *startR, int *startY, int *startX);
+int storeLevelCache(const char *levelName, const LevelSource *source, const Level *level, int startR, int startY, int startX);
+
+#endif // LEVELCACHE_H
@@ -0,0 +1,10 @@
+#ifndef LINT_H
+#define LINT_H
+
+// Upper bound on worker threads, default is one per core
+#define LINT_MAX_THREADS 64
+
+// Function declarations
+int lintCommand(int argc, char **argv);
+
+#endif // LINT_H
@@ -12,16 +12,63 @@
 #include <sys/stat.h>
 #endif
 
+// Messages are batched in memory and written once the buffer is this full, an
+// error is logged, or the oldest waited this many seconds (on a flush thread).
+// Fatal signals write out what is pending before the process dies.
+#define LOGLIB_BUFFER_SIZE 16384
+#define LOGLIB_FLUSH_THRESHOLD (LOGLIB_BUFFER_SIZE * 3 / 4)
+#define LOGLIB_FLUSH_SECONDS 1
+
+// Log levels, messages below loglib_level are dropped before formatting
+#define LOGLIB_LEVEL_INFO  0
+#define LOGLIB_LEVEL_WARN  1
+#define LOGLIB_LEVEL_ERROR 2
+#define LOGLIB_LEVEL_NONE  3
+
+// Calls below this level are compiled out, build with e.g. -DLOGLIB_MIN_LEVEL=1
+#ifndef LOGLIB_MIN_LEVEL
+#define LOGLIB_MIN_LEVEL LOGLIB_LEVEL_INFO
+#endif
+
 // External variable declarations
 extern FILE *loglib_file;
 extern time_t loglib_start_time;
 extern int loglib_initialized;
+extern int loglib_buffered;
+extern int loglib_level;
 
 // Function declarations
 void log_start_path(const char *path);
 void log_start(void);
-void log_info(const char *fmt, ...);
-void log_warn(const char *fmt, ...);
-void log_error(const char *fmt, ...);
+void log_flush(void);
+void log_flush_from_signal(void);
+void log_set_buffered(int enabled);
+void log_set_level(int level);
+void loglib_log(int level, const char *fmt, ...);
+
+// Logging macros, arguments aren't evaluated when the level is filtered out
+#define LOGLIB_CALL(level, ...) \
+    ((level) >= loglib_level ? loglib_log((level), __VA_ARGS__) : (void)0)
+// Compiled out call, arguments still count as used but are never evaluated
+#define LOGLIB_NOOP(level, ...) \
+    (0 ? loglib_log((level), __VA_ARGS__) : (void)0)
+
+#if LOGLIB_MIN_LEVEL <= LOGLIB_LEVEL_INFO
+#define log_info(...) LOGLIB_CALL(LOGLIB_LEVEL_INFO, __VA_ARGS__)
+#else
+#define log_info(...) LOGLIB_NOOP(LOGLIB_LEVEL_INFO, __VA_ARGS__)
+#endif
+
+#if LOGLIB_MIN_LEVEL <= LOGLIB_LEVEL_WARN
+#define log_warn(...) LOGLIB_CALL(LOGLIB_LEVEL_WARN, __VA_ARGS__)
+#else
+#define log_warn(...) LOGLIB_NOOP(LOGLIB_LEVEL_WARN, __VA_ARGS__)
+#endif
+
+#if LOGLIB_MIN_LEVEL <= LOGLIB_LEVEL_ERROR
+#define log_error(...) LOGLIB_CALL(LOGLIB_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define log_error(...) LOGLIB_NOOP(LOGLIB_LEVEL_ERROR, __VA_ARGS__)
+#endif
 
 #endif // LOGLIB_H
@@ -18,6 +18,7 @@
 #include <direct.h>
 #else
 #include <sys/stat.h>
+#include <unistd.h>
 #endif
 
 // ANSI escape color helper
@@ -31,6 +32,8 @@
 #define CLEAR_SCREEN() platform_clear_screen()
 #define HOME_CURSOR() platform_home_cursor()
 
+void platform_enter_raw_mode(void);
+void platform_restore_terminal(void);
 char getch_portable(void);
 void flushInput(void);
 void platform_clear_screen(void);
@@ -0,0 +1,29 @@
+#ifndef RENDER_H
+#define RENDER_H
+
+#include "level.h"
+
+// Tiles (2 characters wide for font justification), glyph then color code
+// Get color codes from here https://i.sstatic.net/9UVnC.png
+#define TILE_PLAYER         "<>", "91;41"
+#define TILE_START_RESIDUE  "[]", "90;40"
+#define TILE_VOID           "  ", "90;40"
+#define TILE_WALL           "##", "37;100"
+#define TILE_DOOR           "##", "96;46"
+#define TILE_DOOR_RESIDUE   "##", "90;40" // Shows up when door is open (id = -1)
+#define TILE_KEY            "o+", "96;40"
+#define TILE_KEY_RESIDUE    "__", "90;40" // Shows up when key is collected (id = -1)
+#define TILE_GOAL           "[]", "93;43"
+#define TILE_PASSAGE        "[]", "93;42"
+#define TILE_ERROR          "??", "30;105" // Shows up when flagged (id = -2)
+#define TILE_SYMBOL_COLOR   "90;40" // For text symbols, drawn as "<symbol> "
+
+// Screen row of the first map row, status line is on row 1
+#define RENDER_MAP_TOP 3
+
+// Function declarations
+void renderGame(const Level *level, int playerR, int playerY, int playerX, int movesMade, int victory);
+void renderInvalidate(void);
+void freeRenderer(void);
+
+#endif // RENDER_H
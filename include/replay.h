@@ -0,0 +1,35 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+// Moves between two progress reports
+#define REPLAY_PROGRESS_INTERVAL 4096
+// Moves decoded at once when replaying packed saves
+#define REPLAY_CHUNK_SIZE 4096
+
+#include "binio.h"
+#include "gamestate.h"
+
+// Final state after a replay
+typedef struct {
+    int playerX;
+    int playerY;
+    int playerR;
+    int victory;
+    int acceptedCount;
+    int rejectedCount;
+    int *rejected;  // indexes of moves that were blocked or not W/A/S/D
+    int keyCount;
+    int *keys;      // ids of keys collected, in pickup order
+} ReplayResult;
+
+typedef void (*ReplayProgress)(int done, int total);
+
+// Function declarations
+int replayMoves(const char *moves, int count, ReplayProgress progress, ReplayResult *result);
+int replaySave(const SaveView *view, ReplayProgress progress, ReplayResult *result);
+int replayState(GameState *state, const SaveView *view, ReplayResult *result);
+int replayFile(const char *savePath, ReplayResult *result);
+void freeReplayResult(ReplayResult *result);
+int replayCommand(int argc, char **argv);
+
+#endif // REPLAY_H
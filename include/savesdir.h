@@ -9,6 +9,7 @@
 #define LEVELS_FOLDER "saves/levels"
 
 extern int localDataLoaded;
+extern int localDataVersion;
 extern int levelCount;
 extern char** levelNames;
 extern int* finishedGameCounts;
@@ -19,5 +20,9 @@ extern char*** ongoingPlayerNames;
 
 void freeLocalData(void);
 void fetchLocalData(void);
+void updateLocalData(const char *levelName, const char *playerName, int finished, int movesCount);
+int refreshLocalData(void);
+int findLevelIndex(const char *levelName);
+void noteLocalFolderChange(const char *levelName, int finished);
 
 #endif // SAVESDIR_H
@@ -0,0 +1,21 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "level.h"
+
+// Shortest solution found by solveLevel
+typedef struct {
+    int found;
+    int moveCount;
+    char *moves;          // W/A/S/D sequence, same format as save files
+    long long expanded;   // states taken off the queue
+    long long visited;    // distinct (position, keys) states seen
+    double seconds;
+} SolverResult;
+
+// Function declarations
+int solveLevel(const Level *level, int startR, int startY, int startX, SolverResult *result);
+void freeSolverResult(SolverResult *result);
+int solveCommand(int argc, char **argv);
+
+#endif // SOLVER_H
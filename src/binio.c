@@ -1,8 +1,50 @@
 #include "binio.h"
 #include <string.h>
 #include <errno.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+int saveSyncDirectory = -1;
+
+// Directories already made by createDirectories, so repeated saves skip the mkdir calls
+static char **knownDirectories = NULL;
+static int knownDirectoryCount = 0;
+
+static int isKnownDirectory(const char *path) {
+    for (int i = 0; i < knownDirectoryCount; i++) {
+        if (strcmp(knownDirectories[i], path) == 0) return 1;
+    }
+    return 0;
+}
+
+static void rememberDirectory(const char *path) {
+    if (knownDirectoryCount == 0 || (knownDirectoryCount >= 8 && (knownDirectoryCount & (knownDirectoryCount - 1)) == 0)) {
+        int capacity = knownDirectoryCount ? knownDirectoryCount * 2 : 8;
+        char **grown = (char**)realloc(knownDirectories, capacity * sizeof(char*));
+        if (!grown) return;
+        knownDirectories = grown;
+    }
+    char *copy = strdup(path);
+    if (copy) knownDirectories[knownDirectoryCount++] = copy;
+}
+
+// Forget directories made so far, e.g. after they were removed from outside.
+void forgetDirectories(void) {
+    for (int i = 0; i < knownDirectoryCount; i++) free(knownDirectories[i]);
+    free(knownDirectories);
+    knownDirectories = NULL;
+    knownDirectoryCount = 0;
+}
 
 void createDirectories(const char *path) {
+    if (isKnownDirectory(path)) return;
     char *pathCopy = strdup(path);
     char *p = pathCopy;
     while (*p) {
@@ -26,6 +68,105 @@ void createDirectories(const char *path) {
 #endif
     }
     free(pathCopy);
+    rememberDirectory(path);
+}
+
+// Push written data of file to disk.
+int syncFile(FILE *file) {
+    if (fflush(file) != 0) return 0;
+#ifdef _WIN32
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+// Cut file down to size bytes and continue writing at its end.
+int truncateFile(FILE *file, long size) {
+    if (fflush(file) != 0) return 0;
+#ifdef _WIN32
+    if (_chsize(_fileno(file), size) != 0) return 0;
+#else
+    if (ftruncate(fileno(file), (off_t)size) != 0) return 0;
+#endif
+    return fseek(file, 0, SEEK_END) == 0;
+}
+
+// Internal: make rename inside directory durable, only when saveSyncDirectory is set.
+static void syncDirectory(const char *dirPath) {
+#ifndef _WIN32
+    int fd = open(dirPath, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+#else
+    (void)dirPath; // NTFS metadata is journaled, MOVEFILE_WRITE_THROUGH covers it
+#endif
+}
+
+// Internal: CONMAZE_SYNC_DIR set to anything but "0" turns directory sync on.
+static int syncDirectoryFromEnv(void) {
+    const char *env = getenv("CONMAZE_SYNC_DIR");
+    return env && *env && strcmp(env, "0") != 0;
+}
+
+// Internal: move temp file over destination in one step.
+static int replaceFile(const char *from, const char *to) {
+#ifdef _WIN32
+    return MoveFileExA(from, to, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    return rename(from, to) == 0;
+#endif
+}
+
+// Write file so that readers see either the old or the whole new content:
+// data goes to a hidden temp file next to it, is synced and renamed into place.
+int writeFileAtomic(const char *path, const void *bytes, size_t size) {
+    char dirPath[512];
+    char tempPath[512];
+    const char *name = strrchr(path, '/');
+    const char *backslash = strrchr(path, '\\');
+    if (!name || (backslash && backslash > name)) name = backslash;
+    name = name ? name + 1 : path;
+    int dirLength = (int)(name - path);
+    // "<dir>/.<name>.tmp", hidden from save listings
+    if (snprintf(tempPath, sizeof(tempPath), "%.*s.%s.tmp", dirLength, path, name) >= (int)sizeof(tempPath)) {
+        log_error("Path too long to save: %s", path);
+        return 0;
+    }
+    if (dirLength > 0) {
+        snprintf(dirPath, sizeof(dirPath), "%.*s", dirLength - 1, path);
+        createDirectories(dirPath);
+    } else {
+        strcpy(dirPath, ".");
+    }
+
+    FILE *file = fopen(tempPath, "wb");
+    if (!file && errno == ENOENT && dirLength > 0) {
+        // Directory was removed since it was made, make it again
+        forgetDirectories();
+        createDirectories(dirPath);
+        file = fopen(tempPath, "wb");
+    }
+    if (!file) {
+        log_error("Failed to open file for writing: %s (errno: %d)", tempPath, errno);
+        return 0;
+    }
+    int ok = fwrite(bytes, 1, size, file) == size && syncFile(file);
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) {
+        log_error("Failed to write data to file: %s (errno: %d)", tempPath, errno);
+        remove(tempPath);
+        return 0;
+    }
+    if (!replaceFile(tempPath, path)) {
+        log_error("Failed to replace file: %s (errno: %d)", path, errno);
+        remove(tempPath);
+        return 0;
+    }
+    if (saveSyncDirectory < 0) saveSyncDirectory = syncDirectoryFromEnv();
+    if (saveSyncDirectory) syncDirectory(dirPath);
+    return 1;
 }
 
 int findData(const char *path) {
@@ -37,72 +178,483 @@ int findData(const char *path) {
     return 0;
 }
 
-int saveData(const char *path, int count, const char *data) {
-    // Extract directory path
-    char *pathCopy = strdup(path);
-    char *lastSep = strrchr(pathCopy, '/');
-    if (!lastSep) lastSep = strrchr(pathCopy, '\\');
-    if (lastSep) {
-        *lastSep = '\0';
-        createDirectories(pathCopy);
+// Hash bytes into running FNV-1a hash, start with HASH_SEED.
+uint32_t hashData(uint32_t hash, const void *data, size_t size) {
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
     }
-    free(pathCopy);
-    FILE *file = fopen(path, "wb");
-    if (!file) {
-        log_error("Failed to open file for writing: %s (errno: %d)", path, errno);
+    return hash;
+}
+
+// Hash whole file, used to tell which version of a level a save was made on.
+int hashFile(const char *path, uint32_t *out_hash) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return 0;
+    uint32_t hash = HASH_SEED;
+    unsigned char block[4096];
+    size_t got;
+    while ((got = fread(block, 1, sizeof(block), file)) > 0) {
+        hash = hashData(hash, block, got);
+    }
+    int ok = !ferror(file);
+    fclose(file);
+    if (ok) *out_hash = hash;
+    return ok;
+}
+
+static const char moveChars[4] = { 'w', 'a', 's', 'd' };
+
+// Internal: 2 bit code of a move, -1 if it can't be packed.
+static int moveCode(char move) {
+    switch (move) {
+        case 'w': return 0;
+        case 'a': return 1;
+        case 's': return 2;
+        case 'd': return 3;
+        default: return -1;
+    }
+}
+
+static void putU32(unsigned char *at, uint32_t value) {
+    at[0] = (unsigned char)value;
+    at[1] = (unsigned char)(value >> 8);
+    at[2] = (unsigned char)(value >> 16);
+    at[3] = (unsigned char)(value >> 24);
+}
+
+static uint32_t getU32(const unsigned char *at) {
+    return (uint32_t)at[0] | ((uint32_t)at[1] << 8) | ((uint32_t)at[2] << 16) | ((uint32_t)at[3] << 24);
+}
+
+// Internal: pick smallest encoding for moves, returns payload size.
+static size_t chooseEncoding(const char *data, int count, int *out_encoding) {
+    size_t runs = 0;
+    for (int i = 0; i < count; ) {
+        if (moveCode(data[i]) < 0) {
+            *out_encoding = SAVE_ENCODING_RAW;
+            return (size_t)count;
+        }
+        // Runs longer than SAVE_RLE_MAX_RUN are split
+        int length = 1;
+        while (i + length < count && data[i + length] == data[i] && length < SAVE_RLE_MAX_RUN) length++;
+        runs++;
+        i += length;
+    }
+    size_t packed = ((size_t)count + 3) / 4;
+    if (runs < packed) {
+        *out_encoding = SAVE_ENCODING_RLE;
+        return runs;
+    }
+    *out_encoding = SAVE_ENCODING_PACKED;
+    return packed;
+}
+
+// Internal: write moves into payload with given encoding.
+static void encodeMoves(const char *data, int count, int encoding, unsigned char *out) {
+    switch (encoding) {
+        case SAVE_ENCODING_RAW:
+            memcpy(out, data, (size_t)count);
+        break;
+        case SAVE_ENCODING_PACKED:
+            memset(out, 0, ((size_t)count + 3) / 4);
+            for (int i = 0; i < count; i++) {
+                out[i / 4] |= (unsigned char)(moveCode(data[i]) << ((i % 4) * 2));
+            }
+        break;
+        case SAVE_ENCODING_RLE:
+            // Each byte is one run: low 2 bits move, high 6 bits length - 1
+            for (int i = 0; i < count; ) {
+                int length = 1;
+                while (i + length < count && data[i + length] == data[i] && length < SAVE_RLE_MAX_RUN) length++;
+                *out++ = (unsigned char)(moveCode(data[i]) | ((length - 1) << 2));
+                i += length;
+            }
+        break;
+    }
+}
+
+// Write moves in current save format. levelHash is hashFile of the level, 0 if unknown.
+int saveData(const char *path, int count, const char *data, uint32_t levelHash) {
+    if (count < 0 || (count > 0 && !data)) count = 0;
+
+    int encoding;
+    size_t payloadSize = chooseEncoding(data, count, &encoding);
+    size_t size = SAVE_HEADER_SIZE + payloadSize;
+    unsigned char *bytes = (unsigned char*)malloc(size);
+    if (!bytes) {
+        log_error("Failed to allocate %zu bytes for save: %s", size, path);
         return 0;
     }
-    if (fwrite(&count, sizeof(int), 1, file) != 1) {
-        log_error("Failed to write count to file: %s", path);
-        fclose(file);
+    memcpy(bytes, SAVE_MAGIC, 4);
+    bytes[4] = SAVE_VERSION;
+    bytes[5] = (unsigned char)encoding;
+    bytes[6] = bytes[7] = 0;
+    putU32(bytes + 8, (uint32_t)count);
+    putU32(bytes + 12, levelHash);
+    encodeMoves(data, count, encoding, bytes + SAVE_HEADER_SIZE);
+
+    int ok = writeFileAtomic(path, bytes, size);
+    free(bytes);
+    if (!ok) return 0;
+    log_info("Successfully saved data to %s", path);
+    return 1;
+}
+
+// Internal: map whole file read-only, 0 on failure or empty file.
+static int mapFile(const char *path, SaveView *view) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || size.QuadPart <= 0) {
+        CloseHandle(file);
         return 0;
     }
-    if (count > 0 && data) {
-        if (fwrite(data, sizeof(char), (size_t)count, file) != (size_t)count) {
-            log_error("Failed to write data to file: %s", path);
-            fclose(file);
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mapping) {
+        CloseHandle(file);
+        return 0;
+    }
+    const void *bytes = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!bytes) {
+        CloseHandle(mapping);
+        CloseHandle(file);
+        return 0;
+    }
+    view->fileHandle = file;
+    view->mappingHandle = mapping;
+    view->bytes = (const unsigned char*)bytes;
+    view->size = (size_t)size.QuadPart;
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || fileStat.st_size <= 0) {
+        close(fd);
+        return 0;
+    }
+    void *bytes = mmap(NULL, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // mapping stays valid
+    if (bytes == MAP_FAILED) return 0;
+    view->bytes = (const unsigned char*)bytes;
+    view->size = (size_t)fileStat.st_size;
+#endif
+    return 1;
+}
+
+// Map save file and parse its header, moves are decoded on demand with a SaveCursor.
+// Understands versioned and legacy saves. Close with closeSaveView.
+int openSaveView(const char *path, SaveView *view) {
+    memset(view, 0, sizeof(*view));
+    if (!mapFile(path, view)) return 0;
+
+    const unsigned char *bytes = view->bytes;
+    if (view->size >= SAVE_HEADER_SIZE && memcmp(bytes, SAVE_JOURNAL_MAGIC, 4) == 0) {
+        // Journal: every byte after the header is a move, a torn last write just loses it
+        view->encoding = SAVE_ENCODING_RAW;
+        view->payload = bytes + SAVE_HEADER_SIZE;
+        view->payloadSize = view->size - SAVE_HEADER_SIZE;
+        view->count = view->payloadSize > (size_t)SAVE_MAX_MOVES ? SAVE_MAX_MOVES : (int)view->payloadSize;
+        view->levelHash = getU32(bytes + 12);
+    } else if (view->size >= SAVE_HEADER_SIZE && memcmp(bytes, SAVE_MAGIC, 4) == 0) {
+        uint32_t stored = getU32(bytes + 8);
+        if (bytes[4] != SAVE_VERSION || bytes[5] > SAVE_ENCODING_RLE || stored > (uint32_t)SAVE_MAX_MOVES) {
+            log_error("Unsupported save version %d (encoding %d): %s", bytes[4], bytes[5], path);
+            closeSaveView(view);
             return 0;
         }
+        view->encoding = bytes[5];
+        view->count = (int)stored;
+        view->levelHash = getU32(bytes + 12);
+        view->payload = bytes + SAVE_HEADER_SIZE;
+        view->payloadSize = view->size - SAVE_HEADER_SIZE;
+    } else {
+        // Legacy: native int count followed by one char per move
+        if (view->size < sizeof(int)) {
+            closeSaveView(view);
+            return 0;
+        }
+        memcpy(&view->count, bytes, sizeof(int));
+        view->encoding = SAVE_ENCODING_RAW;
+        view->payload = bytes + sizeof(int);
+        view->payloadSize = view->size - sizeof(int);
+    }
+
+    // Fixed size encodings can be checked up front, runs are checked while decoding
+    size_t needed = 0;
+    if (view->encoding == SAVE_ENCODING_RAW) needed = (size_t)view->count;
+    if (view->encoding == SAVE_ENCODING_PACKED) needed = ((size_t)view->count + 3) / 4;
+    if (view->count < 0 || view->payloadSize < needed) {
+        closeSaveView(view);
+        return 0;
     }
-    fclose(file);
-    log_info("Successfully saved data to %s", path);
     return 1;
 }
 
-int loadData(const char *path, int *out_count, char **out_data) {
-    if (!out_count || !out_data) return 0;
+void closeSaveView(SaveView *view) {
+    if (view->bytes) {
+#ifdef _WIN32
+        UnmapViewOfFile(view->bytes);
+        CloseHandle((HANDLE)view->mappingHandle);
+        CloseHandle((HANDLE)view->fileHandle);
+#else
+        munmap((void*)view->bytes, view->size);
+#endif
+    }
+    memset(view, 0, sizeof(*view));
+}
+
+void startSaveCursor(SaveCursor *cursor, const SaveView *view) {
+    memset(cursor, 0, sizeof(*cursor));
+    cursor->view = view;
+}
+
+// Decode up to max next moves into out, returns how many were decoded.
+// Fewer than asked before the end of save means the run data is cut short.
+int readSaveMoves(SaveCursor *cursor, char *out, int max) {
+    const SaveView *view = cursor->view;
+    int left = view->count - cursor->index;
+    if (max > left) max = left;
+    if (max <= 0) return 0;
+
+    if (view->encoding == SAVE_ENCODING_RAW) {
+        memcpy(out, view->payload + cursor->index, (size_t)max);
+        cursor->index += max;
+        return max;
+    }
+    int done = 0;
+    while (done < max) {
+        int i = cursor->index;
+        if (view->encoding == SAVE_ENCODING_PACKED) {
+            out[done] = moveChars[(view->payload[i / 4] >> ((i % 4) * 2)) & 3];
+        } else {
+            if (!cursor->runLeft) {
+                if (cursor->offset >= view->payloadSize) break;
+                unsigned char run = view->payload[cursor->offset++];
+                cursor->runLeft = (run >> 2) + 1;
+                cursor->runMove = moveChars[run & 3];
+            }
+            out[done] = cursor->runMove;
+            cursor->runLeft--;
+        }
+        cursor->index++;
+        done++;
+    }
+    return done;
+}
+
+// Single move of save, for reporting. Walks the runs of RLE saves.
+char saveMoveAt(const SaveView *view, int index) {
+    if (index < 0 || index >= view->count) return '\0';
+    switch (view->encoding) {
+        case SAVE_ENCODING_RAW:
+            return (char)view->payload[index];
+        case SAVE_ENCODING_PACKED:
+            return moveChars[(view->payload[index / 4] >> ((index % 4) * 2)) & 3];
+        default:
+            for (size_t i = 0; i < view->payloadSize; i++) {
+                int length = (view->payload[i] >> 2) + 1;
+                if (index < length) return moveChars[view->payload[i] & 3];
+                index -= length;
+            }
+            return '\0';
+    }
+}
+
+// Start of an autosave journal, moves are then appended one byte each.
+int writeJournalHeader(FILE *file, uint32_t levelHash) {
+    unsigned char header[SAVE_HEADER_SIZE] = {0};
+    memcpy(header, SAVE_JOURNAL_MAGIC, 4);
+    header[4] = SAVE_VERSION;
+    header[5] = SAVE_ENCODING_RAW;
+    putU32(header + 12, levelHash);
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+// Read only the move count of a save file.
+int peekData(const char *path, int *out_count) {
+    if (!out_count) return 0;
     *out_count = 0;
-    *out_data = NULL;
 
     FILE *file = fopen(path, "rb");
     if (!file) return 0;
 
-    int loadedMoves = 0;
-    if (fread(&loadedMoves, sizeof(int), 1, file) != 1) {
+    unsigned char header[SAVE_HEADER_SIZE];
+    size_t got = fread(header, 1, sizeof(header), file);
+    if (got == SAVE_HEADER_SIZE && memcmp(header, SAVE_JOURNAL_MAGIC, 4) == 0) {
+        // Journal: every byte after the header is a move, same as openSaveView()
+        long size = fseek(file, 0, SEEK_END) == 0 ? ftell(file) : -1;
         fclose(file);
-        return 0;
+        if (size < SAVE_HEADER_SIZE) return 0;
+        long moves = size - SAVE_HEADER_SIZE;
+        *out_count = moves > SAVE_MAX_MOVES ? SAVE_MAX_MOVES : (int)moves;
+        return 1;
     }
+    fclose(file);
 
-    char *loadedSequence = NULL;
-    if (loadedMoves > 0) {
-        loadedSequence = (char*)malloc((size_t)loadedMoves * sizeof(char));
-        if (!loadedSequence) {
-            fclose(file);
-            return 0;
+    if (got == SAVE_HEADER_SIZE && memcmp(header, SAVE_MAGIC, 4) == 0) {
+        uint32_t stored = getU32(header + 8);
+        if (header[4] != SAVE_VERSION || stored > (uint32_t)SAVE_MAX_MOVES) return 0;
+        *out_count = (int)stored;
+        return 1;
+    }
+    int loadedMoves = 0;
+    if (got < sizeof(int)) return 0;
+    memcpy(&loadedMoves, header, sizeof(int));
+    if (loadedMoves < 0) return 0;
+    *out_count = loadedMoves;
+    return 1;
+}
+
+int deleteData(const char *path) {
+    return (remove(path) == 0) ? 1 : 0;
+}
+
+// Internal: path of index file inside given directory.
+static void saveIndexPath(char *buf, size_t bufsz, const char *dirPath) {
+    size_t length = strlen(dirPath);
+    int hasSep = length > 0 && (dirPath[length - 1] == '/' || dirPath[length - 1] == '\\');
+    snprintf(buf, bufsz, "%s%s" SAVE_INDEX_FILE, dirPath, hasSep ? "" : DIR_SEP);
+}
+
+// Sub-second part of modification time, where the platform keeps one
+#if defined(__APPLE__)
+#define STAT_MTIME_NSEC(st) ((st).st_mtimespec.tv_nsec)
+#elif !defined(_WIN32)
+#define STAT_MTIME_NSEC(st) ((st).st_mtim.tv_nsec)
+#endif
+
+// Index is fresh when no file was added or removed from directory since it was written.
+int isSaveIndexFresh(const char *dirPath) {
+    char indexPath[512];
+    saveIndexPath(indexPath, sizeof(indexPath), dirPath);
+    struct stat dirStat, indexStat;
+    if (stat(dirPath, &dirStat) != 0 || stat(indexPath, &indexStat) != 0) return 0;
+    if (indexStat.st_mtime != dirStat.st_mtime) return indexStat.st_mtime > dirStat.st_mtime;
+#ifdef STAT_MTIME_NSEC
+    return STAT_MTIME_NSEC(indexStat) >= STAT_MTIME_NSEC(dirStat);
+#else
+    return 0; // same second, a save may have been added after the index was written
+#endif
+}
+
+typedef struct {
+    SaveIndexEntry entry;
+    int line;
+} IndexLine;
+
+// Internal: by name, newest line first among equal names.
+static int compareIndexLines(const void *a, const void *b) {
+    const IndexLine *la = (const IndexLine*)a;
+    const IndexLine *lb = (const IndexLine*)b;
+    int byName = strcmp(la->entry.name, lb->entry.name);
+    if (byName != 0) return byName;
+    return lb->line - la->line;
+}
+
+static int compareIndexName(const void *key, const void *element) {
+    return strcmp((const char*)key, ((const SaveIndexEntry*)element)->name);
+}
+
+// Read index of directory, sorted by name. Index is appended to, so for
+// repeated names the last line wins. Returns 0 if there is no index, 2 if
+// repeated names were dropped and the index is worth rewriting.
+int readSaveIndex(const char *dirPath, SaveIndexEntry **out_entries, int *out_count) {
+    *out_entries = NULL;
+    *out_count = 0;
+
+    char indexPath[512];
+    saveIndexPath(indexPath, sizeof(indexPath), dirPath);
+    FILE *file = fopen(indexPath, "r");
+    if (!file) return 0;
+
+    IndexLine *lines = NULL;
+    int count = 0, capacity = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), file)) {
+        char *end = line + strlen(line);
+        while (end > line && (end[-1] == '\n' || end[-1] == '\r')) end--;
+        *end = '\0';
+
+        // "<moves> <file name>"
+        char *name;
+        long moves = strtol(line, &name, 10);
+        if (name == line || *name != ' ' || name[1] == '\0' || moves < 0) continue; // malformed line
+        name++;
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            IndexLine *grown = (IndexLine*)realloc(lines, capacity * sizeof(IndexLine));
+            if (!grown) break;
+            lines = grown;
         }
-        if (fread(loadedSequence, sizeof(char), (size_t)loadedMoves, file) != (size_t)loadedMoves) {
-            free(loadedSequence);
-            fclose(file);
-            return 0;
+        lines[count].entry.name = strdup(name);
+        if (!lines[count].entry.name) break;
+        lines[count].entry.count = (int)moves;
+        lines[count].line = count;
+        count++;
+    }
+    fclose(file);
+
+    if (count > 1) qsort(lines, count, sizeof(IndexLine), compareIndexLines);
+
+    SaveIndexEntry *entries = (SaveIndexEntry*)malloc((count ? count : 1) * sizeof(SaveIndexEntry));
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (entries && (kept == 0 || strcmp(entries[kept - 1].name, lines[i].entry.name) != 0)) {
+            entries[kept++] = lines[i].entry;
+        } else {
+            free(lines[i].entry.name);
         }
     }
+    free(lines);
+    if (!entries) return 0;
+
+    *out_entries = entries;
+    *out_count = kept;
+    return kept < count ? 2 : 1;
+}
 
+// Replace index of directory with given entries.
+int writeSaveIndex(const char *dirPath, const SaveIndexEntry *entries, int count) {
+    char indexPath[512];
+    saveIndexPath(indexPath, sizeof(indexPath), dirPath);
+    FILE *file = fopen(indexPath, "w");
+    if (!file) {
+        log_error("Failed to write save index: %s (errno: %d)", indexPath, errno);
+        return 0;
+    }
+    for (int i = 0; i < count; i++) {
+        fprintf(file, "%d %s\n", entries[i].count, entries[i].name);
+    }
     fclose(file);
-    *out_count = loadedMoves;
-    *out_data = loadedSequence;
     return 1;
 }
 
-int deleteData(const char *path) {
-    return (remove(path) == 0) ? 1 : 0;
+// Record one save in index of directory, without rewriting the rest.
+int appendSaveIndex(const char *dirPath, const char *name, int count) {
+    char indexPath[512];
+    saveIndexPath(indexPath, sizeof(indexPath), dirPath);
+    FILE *file = fopen(indexPath, "a");
+    if (!file) {
+        log_warn("Failed to update save index: %s (errno: %d)", indexPath, errno);
+        return 0;
+    }
+    fprintf(file, "%d %s\n", count, name);
+    fclose(file);
+    return 1;
+}
+
+// Find file name in entries returned by readSaveIndex, NULL if not indexed.
+const SaveIndexEntry *findSaveIndex(const SaveIndexEntry *entries, int count, const char *name) {
+    if (!entries || count <= 0) return NULL;
+    return (const SaveIndexEntry*)bsearch(name, entries, count, sizeof(SaveIndexEntry), compareIndexName);
+}
+
+void freeSaveIndex(SaveIndexEntry *entries, int count) {
+    if (!entries) return;
+    for (int i = 0; i < count; i++) free(entries[i].name);
+    free(entries);
 }
@@ -0,0 +1,405 @@
+#include "game.h"
+#include "loglib.h"
+#include "savesdir.h"
+#include "binio.h"
+#include "journal.h"
+#include "levelcache.h"
+#include "gamestate.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+// ------------------------------------------------------------------------------------------------
+// SYMBOL       METADATA    TILE        INFO
+// ------------------------------------------------------------------------------------------------
+// '#'          No          Wall        Impassable
+// '&'          Yes         Door        Impassable until unlock
+// '!'          Yes         Key         Collectible, unlocks doors of same ID
+// ' '          No          Void        Passable
+// '^'          Yes         Passage     Sends player to passage with same ID (must be 2 per ID)
+// '@'          No          Start       Player start, passable
+// '$'          No          Goal        Victory upon reaching
+// a-zA-Z1-9    No          Text        Display only, passable
+// ------------------------------------------------------------------------------------------------
+// ID's are placed in metadata field, beyond the right side of room, ORDER MATTERS!
+// Doors, keys, start has residue details (they act like Text)
+// When player enters passage, it appears on top of next passage, to go back it will need to step off and enter back, make sure to leave room
+// Do not let player escape map, case unhandled
+
+// Game state variables
+int isGameLoaded = 0; // is a game running?
+char* loadedLevelName = NULL;
+uint32_t loadedLevelHash = 0; // hashFile of level, stored in saves
+Level level = {0};
+GameState game = {0}; // player and metadata of the loaded game, plays on level itself
+int movesMade = 0;
+char *moveSequence = NULL;
+static int moveCapacity = 0; // allocated length of moveSequence
+static GameSnapshot pristine = {0}; // state right after load, for restart
+
+// Undo history, one step per move played with the cells its interactions changed
+typedef struct {
+    size_t cell;
+    int metaBefore;
+    int metaAfter;
+    unsigned char specialBefore;
+    unsigned char specialAfter;
+} UndoChange;
+
+typedef struct {
+    char move;
+    int fromX, fromY, fromR; // position before the move
+    int toX, toY, toR;       // after it and its interactions, filled in on undo
+    int firstChange;         // changes of a step run up to the next step's firstChange
+} UndoStep;
+
+static UndoStep *undoSteps = NULL;
+static int stepCount = 0;    // recorded steps, redoable ones included
+static int stepsDone = 0;    // steps currently applied
+static int stepCapacity = 0;
+static UndoChange *undoChanges = NULL;
+static int changeCount = 0;
+static int changeCapacity = 0;
+static int stepOpen = 0;     // cell changes belong to the last step
+static void recordChange(void *context, size_t cell, int meta, int clearSpecial);
+
+// Game state flags
+int loading = 0;
+
+void unloadGame() {
+    // Game ended normally, nothing to recover
+    closeJournal(1);
+
+    // Free map and metadata
+    clearHistory();
+    freeSnapshot(&pristine);
+    freeGameState(&game);
+    freeLevel(&level);
+
+    // Free moveSequence
+    if (moveSequence) {
+        free(moveSequence);
+        moveSequence = NULL;
+    }
+    moveCapacity = 0;
+
+    // Reset game state variables
+    movesMade = 0;
+    loading = 0;
+    isGameLoaded = 0;
+    if (loadedLevelName)
+        free(loadedLevelName);
+    loadedLevelName = NULL;
+    loadedLevelHash = 0;
+}
+
+// Level name from CLI argument, accepts both "tutorial" and "saves/levels/tutorial.dat"
+void parseLevelName(const char *arg, char *out, size_t size) {
+    const char *base = strrchr(arg, '/');
+    snprintf(out, size, "%s", base ? base + 1 : arg);
+    char *dot = strrchr(out, '.');
+    if (dot && strcmp(dot, ".dat") == 0) *dot = '\0';
+}
+
+int loadGame(char* levelFile) {
+    if (isGameLoaded){
+        log_warn("Game unloaded (lazy).");
+        unloadGame();
+    }
+    char fullPath[256];
+    sprintf(fullPath, "%s/%s.dat", LEVELS_FOLDER, levelFile);
+    log_info("Loading level from %s", fullPath);
+
+    // Compiled level is used while source is unchanged
+    int startR, startY, startX;
+    LevelSource source;
+    int haveSource = statLevelSource(fullPath, &source);
+    if (haveSource && loadLevelCache(levelFile, fullPath, &source, &level, &startR, &startY, &startX)) {
+        loadedLevelHash = source.hash;
+        log_info("Using compiled level from cache.");
+        checkLevelIndex(&level); // problems are reported on every load, not only when compiled
+        goto loaded;
+    }
+
+    FILE *f = fopen(fullPath, "rb");
+    if (!f) {
+        log_error("Failed to open level file '%s'.", fullPath);
+        goto cleanup;
+    }
+    int parsed = parseLevel(f, &level, &startR, &startY, &startX, &loadedLevelHash, NULL);
+    fclose(f);
+    if (!parsed) goto cleanup;
+
+    if (haveSource && loadedLevelHash) {
+        source.hash = loadedLevelHash;
+        storeLevelCache(levelFile, &source, &level, startR, startY, startX);
+    }
+
+loaded:
+    loadedLevelName = strdup(levelFile);
+    if (!loadedLevelName) goto cleanup;
+    bindGameState(&game, &level, startR, startY, startX);
+    game.onChange = recordChange;
+
+    isGameLoaded = 1;
+    if (!takeSnapshot(&pristine)) log_warn("Failed to keep initial level state, restart will reload.");
+
+    log_info("Loaded level: WIDTH=%d, ROOM_COUNT=%d", level.width, level.roomCount);
+    return 1;
+
+cleanup:
+    freeLevel(&level);
+    if (loadedLevelName) free(loadedLevelName);
+    loadedLevelName = NULL;
+    loadedLevelHash = 0;
+    return 0;
+}
+
+// Copy the mutable state of the loaded game.
+int takeSnapshot(GameSnapshot *snapshot) {
+    memset(snapshot, 0, sizeof(*snapshot));
+    if (!isGameLoaded) return 0;
+    size_t cells = LEVEL_SIZE(&level);
+    snapshot->tiles = (char*)malloc(cells * sizeof(char));
+    snapshot->meta = (int*)malloc(cells * sizeof(int));
+    snapshot->special = (unsigned char*)malloc((cells + 7) / 8);
+    if (!snapshot->tiles || !snapshot->meta || !snapshot->special) {
+        freeSnapshot(snapshot);
+        return 0;
+    }
+    memcpy(snapshot->tiles, level.tiles, cells * sizeof(char));
+    memcpy(snapshot->meta, level.meta, cells * sizeof(int));
+    memcpy(snapshot->special, level.special, (cells + 7) / 8);
+    snapshot->playerX = game.playerX;
+    snapshot->playerY = game.playerY;
+    snapshot->playerR = game.playerR;
+    snapshot->movesMade = movesMade;
+    snapshot->victory = game.victory;
+    return 1;
+}
+
+// Put the game back to a snapshot of the same level, later moves are dropped.
+void restoreSnapshot(const GameSnapshot *snapshot) {
+    size_t cells = LEVEL_SIZE(&level);
+    memcpy(level.tiles, snapshot->tiles, cells * sizeof(char));
+    memcpy(level.meta, snapshot->meta, cells * sizeof(int));
+    memcpy(level.special, snapshot->special, (cells + 7) / 8);
+    game.playerX = snapshot->playerX;
+    game.playerY = snapshot->playerY;
+    game.playerR = snapshot->playerR;
+    if (snapshot->movesMade < movesMade) movesMade = snapshot->movesMade;
+    game.victory = snapshot->victory;
+    clearHistory(); // recorded changes no longer match the level
+}
+
+void freeSnapshot(GameSnapshot *snapshot) {
+    free(snapshot->tiles);
+    free(snapshot->meta);
+    free(snapshot->special);
+    memset(snapshot, 0, sizeof(*snapshot));
+}
+
+// Start loaded level over from the state kept at load, reloads if there is none.
+int restartGame(void) {
+    if (!isGameLoaded) return 0;
+    closeJournal(1); // the restarted game gets a new one
+    if (!pristine.tiles) {
+        char levelName[256];
+        snprintf(levelName, sizeof(levelName), "%s", loadedLevelName);
+        unloadGame();
+        return loadGame(levelName);
+    }
+    restoreSnapshot(&pristine);
+    movesMade = 0;
+    loading = 0;
+    return 1;
+}
+
+// Start a game of its own on the loaded level as it was right after load, the
+// loaded game is not touched. Without the initial state it starts from the current one.
+int startGameState(GameState *state) {
+    if (!isGameLoaded) return 0;
+    const GameSnapshot *start = pristine.tiles ? &pristine : NULL;
+    int startR = start ? start->playerR : game.playerR;
+    int startY = start ? start->playerY : game.playerY;
+    int startX = start ? start->playerX : game.playerX;
+    if (!initGameState(state, &level, startR, startY, startX)) return 0;
+    if (start) {
+        size_t cells = LEVEL_SIZE(&level);
+        memcpy(state->meta, start->meta, cells * sizeof(int));
+        memcpy(state->special, start->special, (cells + 7) / 8);
+    }
+    return 1;
+}
+
+// Forget undo and redo steps and free their memory.
+void clearHistory(void) {
+    free(undoSteps);
+    free(undoChanges);
+    undoSteps = NULL;
+    undoChanges = NULL;
+    stepCount = stepsDone = stepCapacity = 0;
+    changeCount = changeCapacity = 0;
+    stepOpen = 0;
+}
+
+// Internal: start undo step for a move just played, drops steps that could be redone.
+static int pushStep(char move, int fromX, int fromY, int fromR) {
+    if (stepsDone < stepCount) {
+        changeCount = undoSteps[stepsDone].firstChange;
+        stepCount = stepsDone;
+    }
+    if (stepCount == stepCapacity) {
+        int capacity = stepCapacity ? stepCapacity * 2 : MOVE_BUFFER_MIN;
+        UndoStep *grown = (UndoStep*)realloc(undoSteps, capacity * sizeof(UndoStep));
+        if (!grown) return 0;
+        undoSteps = grown;
+        stepCapacity = capacity;
+    }
+    UndoStep *undo = &undoSteps[stepCount++];
+    undo->move = move;
+    undo->fromX = fromX;
+    undo->fromY = fromY;
+    undo->fromR = fromR;
+    undo->toX = undo->toY = undo->toR = 0;
+    undo->firstChange = changeCount;
+    stepsDone = stepCount;
+    return 1;
+}
+
+// GameChangeHook of the loaded game: note a change about to be made in the open step.
+static void recordChange(void *context, size_t cell, int meta, int clearSpecial) {
+    (void)context;
+    if (stepOpen) {
+        if (changeCount == changeCapacity) {
+            int capacity = changeCapacity ? changeCapacity * 2 : MOVE_BUFFER_MIN;
+            UndoChange *grown = (UndoChange*)realloc(undoChanges, capacity * sizeof(UndoChange));
+            if (!grown) {
+                log_warn("Failed to allocate undo history, it was cleared.");
+                clearHistory();
+            } else {
+                undoChanges = grown;
+                changeCapacity = capacity;
+            }
+        }
+        if (stepOpen) {
+            UndoChange *change = &undoChanges[changeCount++];
+            change->cell = cell;
+            change->metaBefore = level.meta[cell];
+            change->metaAfter = meta;
+            change->specialBefore = (unsigned char)LEVEL_SPECIAL(&level, cell);
+            change->specialAfter = clearSpecial ? 0 : change->specialBefore;
+        }
+    }
+}
+
+// Internal: put cell back to one side of a recorded change.
+static void applyChange(const UndoChange *change, int after) {
+    level.meta[change->cell] = after ? change->metaAfter : change->metaBefore;
+    if (after ? change->specialAfter : change->specialBefore)
+        LEVEL_SET_SPECIAL(&level, change->cell);
+    else
+        LEVEL_CLEAR_SPECIAL(&level, change->cell);
+}
+
+// Internal: log what a step of the loaded game did.
+static void logEvents(const GameEvents *events) {
+    if (events->flags & GAME_EVENT_VICTORY) log_info("Goal was reached.");
+    if (events->flags & GAME_EVENT_KEY) log_info("Key %d was picked up.", events->id);
+    for (int d = 0; d < events->doorsOpened; d++) log_info("Door %d was unlocked.", events->id);
+    if (events->flags & GAME_EVENT_PASSAGE) {
+        log_info("Passage %d used to move to room %d at %d,%d.", events->id, game.playerR, game.playerX, game.playerY);
+    }
+}
+
+// Play a move of the loaded game and record it, so it can be saved and undone.
+// Returns 1 if the move was rejected.
+int playMove(char input) {
+    if (!canStep(&game, input)) return 1;
+    stepOpen = pushStep(input, game.playerX, game.playerY, game.playerR);
+    if (!stepOpen) {
+        log_warn("Failed to allocate undo history, it was cleared.");
+        clearHistory();
+    }
+    GameEvents events = step(&game, input); // cells it changes are recorded in the open step
+    stepOpen = 0;
+    addMoveToSequence(input);
+    logEvents(&events);
+    return 0;
+}
+
+// Take back the last move played, costs only the cells it changed. Returns 0 if there is none.
+int undoMove(void) {
+    if (!isGameLoaded || game.victory || stepsDone == 0) return 0;
+    stepOpen = 0;
+    UndoStep *undo = &undoSteps[stepsDone - 1];
+    int end = stepsDone < stepCount ? undoSteps[stepsDone].firstChange : changeCount;
+    for (int c = end - 1; c >= undo->firstChange; c--) applyChange(&undoChanges[c], 0);
+    undo->toX = game.playerX;
+    undo->toY = game.playerY;
+    undo->toR = game.playerR;
+    game.playerX = undo->fromX;
+    game.playerY = undo->fromY;
+    game.playerR = undo->fromR;
+    stepsDone--;
+    movesMade--;
+    truncateJournal(movesMade);
+    log_info("Undid move %d (%c).", movesMade + 1, undo->move);
+    return 1;
+}
+
+// Play the last undone move again. Returns 0 if there is none.
+int redoMove(void) {
+    if (!isGameLoaded || game.victory || stepsDone == stepCount) return 0;
+    stepOpen = 0;
+    UndoStep *undo = &undoSteps[stepsDone];
+    int end = stepsDone + 1 < stepCount ? undoSteps[stepsDone + 1].firstChange : changeCount;
+    for (int c = undo->firstChange; c < end; c++) applyChange(&undoChanges[c], 1);
+    game.playerX = undo->toX;
+    game.playerY = undo->toY;
+    game.playerR = undo->toR;
+    stepsDone++;
+    addMoveToSequence(undo->move);
+    log_info("Redid move %d (%c).", movesMade, undo->move);
+    return 1;
+}
+
+// Make room for at least capacity moves without further reallocs.
+int reserveMoves(int capacity) {
+    if (capacity <= moveCapacity) return 1;
+    char *grown = (char*)realloc(moveSequence, (size_t)capacity * sizeof(char));
+    if (!grown) return 0;
+    moveSequence = grown;
+    moveCapacity = capacity;
+    return 1;
+}
+
+// Internal: make room for count more moves, capacity doubles so appending stays O(1) amortised.
+static void growMoves(int count) {
+    if (movesMade + count <= moveCapacity) return;
+    int capacity = moveCapacity < MOVE_BUFFER_MIN ? MOVE_BUFFER_MIN : moveCapacity;
+    if (movesMade <= INT_MAX - count) {
+        while (capacity < movesMade + count) capacity = capacity > INT_MAX / 2 ? INT_MAX : capacity * 2;
+    }
+    if (movesMade > INT_MAX - count || !reserveMoves(capacity)) {
+        printf("Failed to allocate %d bytes! The program will now exit.\n", capacity);
+        log_error("Failed to allocate memory for move sequence.");
+        exit(1);
+    }
+}
+
+void addMoveToSequence(char move) {
+    growMoves(1);
+    moveSequence[movesMade] = move;
+    movesMade++;
+    appendJournal(move);
+}
+
+// Append moves played in one go, e.g. by a replay.
+void addMovesToSequence(const char *moves, int count) {
+    growMoves(count);
+    memcpy(moveSequence + movesMade, moves, count);
+    movesMade += count;
+    for (int i = 0; i < count; i++) appendJournal(moves[i]);
+}
@@ -0,0 +1,171 @@
+#include "gamestate.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Start a game on its own copy of the level metadata. Returns 0 when out of memory.
+int initGameState(GameState *state, const Level *level, int startR, int startY, int startX) {
+    bindGameState(state, NULL, startR, startY, startX);
+    state->level = level;
+    size_t cells = LEVEL_SIZE(level);
+    state->meta = (int*)malloc(cells * sizeof(int));
+    state->special = (unsigned char*)malloc((cells + 7) / 8);
+    state->ownsCells = 1;
+    if (!state->meta || !state->special) {
+        freeGameState(state);
+        return 0;
+    }
+    memcpy(state->meta, level->meta, cells * sizeof(int));
+    memcpy(state->special, level->special, (cells + 7) / 8);
+    return 1;
+}
+
+// Start a game that plays on the metadata of level itself, for the loaded game that
+// is drawn from it. Only one such state per level.
+void bindGameState(GameState *state, Level *level, int startR, int startY, int startX) {
+    memset(state, 0, sizeof(*state));
+    state->level = level;
+    state->meta = level ? level->meta : NULL;
+    state->special = level ? level->special : NULL;
+    state->playerX = startX;
+    state->playerY = startY;
+    state->playerR = startR;
+}
+
+void freeGameState(GameState *state) {
+    if (state->ownsCells) {
+        free(state->meta);
+        free(state->special);
+    }
+    memset(state, 0, sizeof(*state));
+}
+
+// Internal: position and cell the move leads to, or 0 when it's not a move or leaves the room.
+static int stepTarget(const GameState *state, char move, int *x, int *y, size_t *cell) {
+    *x = state->playerX;
+    *y = state->playerY;
+    switch (move) {
+        case 'w': (*y)--; break;
+        case 's': (*y)++; break;
+        case 'a': (*x)--; break;
+        case 'd': (*x)++; break;
+        default: return 0;
+    }
+    int width = state->level->width;
+    if (*x < 0 || *x >= width || *y < 0 || *y >= width) return 0;
+    *cell = LEVEL_INDEX(state->level, state->playerR, *y, *x);
+    return 1;
+}
+
+// Internal: 1 if player can stand on cell.
+static int isOpen(const GameState *state, size_t cell) {
+    char tile = state->level->tiles[cell];
+    return tile != CHAR_WALL && !(tile == CHAR_DOOR && state->meta[cell] != -1);
+}
+
+// 1 if the move would not be blocked.
+int canStep(const GameState *state, char move) {
+    int x, y;
+    size_t cell;
+    return stepTarget(state, move, &x, &y, &cell) && isOpen(state, cell);
+}
+
+// Other end of passage id, the first of its group that is not from. Returns 0 if there is none.
+int findPassageExit(const Level *level, int id, size_t from, size_t *out) {
+    int count;
+    const size_t *ends = findIdGroup(&level->passages, id, &count);
+    for (int p = 0; p < count; p++) {
+        if (ends[p] == from) continue;
+        *out = ends[p];
+        return 1;
+    }
+    return 0;
+}
+
+// Play moves for as long as they are accepted and land on plain tiles, where step()
+// would do nothing else. Returns how many were played, the move after them needs step().
+int stepPlain(GameState *state, const char *moves, int count) {
+    const Level *level = state->level;
+    int x = state->playerX, y = state->playerY, width = level->width;
+    size_t room = LEVEL_INDEX(level, state->playerR, 0, 0);
+    int k = 0;
+    for (; k < count; k++) {
+        int nx = x, ny = y;
+        switch (moves[k]) {
+            case 'w': ny--; break;
+            case 's': ny++; break;
+            case 'a': nx--; break;
+            case 'd': nx++; break;
+            default: goto done;
+        }
+        if (nx < 0 || nx >= width || ny < 0 || ny >= width) break;
+        size_t cell = room + (size_t)ny * width + nx;
+        char tile = level->tiles[cell];
+        if (tile == CHAR_WALL || tile == CHAR_DOOR || GAME_SPECIAL(state, cell)) break; // left to step()
+        x = nx;
+        y = ny;
+    }
+done:
+    state->playerX = x;
+    state->playerY = y;
+    return k;
+}
+
+// Internal: set metadata of cell, clearing its special bit if asked.
+static void changeCell(GameState *state, size_t cell, int meta, int clearSpecial) {
+    if (state->onChange) state->onChange(state->changeContext, cell, meta, clearSpecial);
+    state->meta[cell] = meta;
+    if (clearSpecial) state->special[cell >> 3] &= (unsigned char)~(1u << (cell & 7));
+}
+
+// Play one move and what happens on the cell it leads to. Touches nothing but the
+// state, blocked moves leave it as it was.
+GameEvents step(GameState *state, char move) {
+    GameEvents events = { GAME_EVENT_BLOCKED, -1, 0 };
+    int x, y;
+    size_t here;
+    if (!stepTarget(state, move, &x, &y, &here) || !isOpen(state, here)) return events;
+    state->playerX = x;
+    state->playerY = y;
+    events.flags = GAME_EVENT_MOVED;
+
+    // Nothing to do on plain tiles, used up keys and flagged passages
+    if (!GAME_SPECIAL(state, here) || state->meta[here] == -2) return events;
+
+    const Level *level = state->level;
+    int id = state->meta[here];
+    switch (level->tiles[here]) {
+        case CHAR_GOAL:
+            state->victory = 1;
+            events.flags |= GAME_EVENT_VICTORY;
+        break;
+        case CHAR_KEY:
+            if (id == -1) break;
+            events.flags |= GAME_EVENT_KEY;
+            events.id = id;
+            int doorCount;
+            const size_t *doors = findIdGroup(&level->doors, id, &doorCount); // keys without doors are reported on load
+            for (int d = 0; d < doorCount; d++) {
+                if (state->meta[doors[d]] != id) continue;
+                changeCell(state, doors[d], -1, 0); // Open door
+                events.doorsOpened++;
+            }
+            if (events.doorsOpened) events.flags |= GAME_EVENT_DOOR;
+            changeCell(state, here, -1, 1); // Mark key as collected
+        break;
+        case CHAR_PASSAGE:;
+            size_t other;
+            events.id = id;
+            if (findPassageExit(level, id, here, &other)) {
+                size_t room = LEVEL_ROOM_SIZE(level);
+                state->playerR = (int)(other / room);
+                state->playerY = (int)(other % room / level->width);
+                state->playerX = (int)(other % level->width);
+                events.flags |= GAME_EVENT_PASSAGE;
+            } else {
+                changeCell(state, here, -2, 1); // Mark as error, unpaired passages are reported on load
+                events.flags |= GAME_EVENT_FLAGGED;
+            }
+        break;
+    }
+    return events;
+}
@@ -0,0 +1,362 @@
+#include "generate.h"
+#include "level.h"
+#include "savesdir.h"
+#include "game.h"
+#include "loglib.h"
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+// Rooms are perfect mazes carved on odd coordinates. A room is entered at the start tile
+// or the end of the passage from the previous room, and left through the cell farthest
+// from there (passage to the next room, or the goal in the last one). Doors go on the way
+// between the two, and each key is placed outside the part of the maze its first door
+// closes off, so every generated level can be finished.
+// Depth first order makes "the part of the maze behind a cell" one range of order indexes.
+
+// Widest room whose cells still fit an int index
+#define GENERATE_MAX_WIDTH 46340
+
+typedef struct {
+    uint64_t rng;
+    const GeneratorOptions *options;
+    int width;
+    int cells;          // per room
+    char *tiles;        // room being built
+    int *meta;
+    int *order;         // floor cells in depth first order from the entry
+    int *position;      // index of each cell in order
+    int *size;          // cells below each order index, itself included
+    int *parent;        // previous cell on the way from the entry, by cell
+    int *depth;         // steps from the entry, by cell
+    int *path;          // cells between entry and exit, also the carving stack
+    int *stage;         // door ids passed to get to each order index
+    int stageCount;
+    int floorCount;
+    int nextDoorId;
+    int nextPassageId;  // extra passages, ids after the ones linking rooms
+} Generator;
+
+// splitmix64, fixed output for a given seed on every platform
+static uint64_t nextRandom(Generator *gen) {
+    uint64_t z = (gen->rng += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform number in [0, bound), bound > 0.
+static int randomBelow(Generator *gen, int bound) {
+    return (int)(((nextRandom(gen) >> 32) * (uint64_t)bound) >> 32);
+}
+
+static int roundCount(double density, int cells) {
+    if (density <= 0) return 0;
+    if (density > 1) density = 1;
+    return (int)(density * cells + 0.5);
+}
+
+// Internal: carve a perfect maze from cell start with an explicit stack.
+static void carveMaze(Generator *gen, int start) {
+    static const int dx[4] = { 0, 0, -2, 2 };
+    static const int dy[4] = { -2, 2, 0, 0 };
+    int width = gen->width;
+    int *stack = gen->path;
+    int top = 0;
+    memset(gen->tiles, CHAR_WALL, gen->cells);
+    gen->tiles[start] = CHAR_VOID;
+    stack[top++] = start;
+    while (top > 0) {
+        int cell = stack[top - 1];
+        int x = cell % width, y = cell / width;
+        int options[4];
+        int optionCount = 0;
+        for (int d = 0; d < 4; d++) {
+            int nx = x + dx[d], ny = y + dy[d];
+            if (nx < 1 || ny < 1 || nx > width - 2 || ny > width - 2) continue;
+            if (gen->tiles[ny * width + nx] == CHAR_WALL) options[optionCount++] = d;
+        }
+        if (!optionCount) {
+            top--;
+            continue;
+        }
+        int d = options[randomBelow(gen, optionCount)];
+        int next = (y + dy[d]) * width + x + dx[d];
+        gen->tiles[(y + dy[d] / 2) * width + x + dx[d] / 2] = CHAR_VOID;
+        gen->tiles[next] = CHAR_VOID;
+        stack[top++] = next;
+    }
+}
+
+// Internal: order floor cells depth first from entry, with subtree sizes and depths.
+static void walkMaze(Generator *gen, int entry) {
+    int width = gen->width;
+    int *stack = gen->path;
+    int top = 0;
+    gen->floorCount = 0;
+    gen->parent[entry] = -1;
+    gen->depth[entry] = 0;
+    stack[top++] = entry;
+    while (top > 0) {
+        int cell = stack[--top];
+        gen->position[cell] = gen->floorCount;
+        gen->order[gen->floorCount++] = cell;
+        int neighbours[4] = { cell - width, cell + width, cell - 1, cell + 1 };
+        for (int d = 0; d < 4; d++) {
+            int next = neighbours[d];
+            if (next == gen->parent[cell] || gen->tiles[next] == CHAR_WALL) continue;
+            gen->parent[next] = cell;
+            gen->depth[next] = gen->depth[cell] + 1;
+            stack[top++] = next;
+        }
+    }
+    for (int i = 0; i < gen->floorCount; i++) gen->size[i] = 1;
+    for (int i = gen->floorCount - 1; i > 0; i--) {
+        gen->size[gen->position[gen->parent[gen->order[i]]]] += gen->size[i];
+    }
+}
+
+// Internal: random empty floor cell among order indexes [first, first + count), leaving out the
+// nested range [skipFirst, skipFirst + skipCount). -1 if there is none.
+static int pickFloor(Generator *gen, int first, int count, int skipFirst, int skipCount) {
+    int candidates = count - skipCount;
+    if (candidates <= 0) return -1;
+    int start = randomBelow(gen, candidates);
+    for (int tries = 0; tries < 16 + candidates; tries++) { // a few guesses, then every candidate once
+        int i = first + (tries < 16 ? randomBelow(gen, candidates) : (start + tries - 16) % candidates);
+        if (i >= skipFirst) i += skipCount;
+        int cell = gen->order[i];
+        if (gen->tiles[cell] == CHAR_VOID) return cell;
+    }
+    return -1;
+}
+
+// Internal: doors on the way to the exit and keys that open them. Keys of an id lie behind
+// the doors of the previous id and in front of the first door of their own, so they are
+// found one id after another and the solver only ever sees a few sets of keys.
+static void placeDoorsAndKeys(Generator *gen, int pathLength) {
+    int doorCount = roundCount(gen->options->doorDensity, pathLength);
+    if (doorCount == 0) return;
+    int keyCount = roundCount(gen->options->keyDensity, gen->floorCount);
+    if (keyCount < 1) keyCount = 1;
+    int groups = keyCount < doorCount ? keyCount : doorCount; // fewer keys than doors, one key opens several
+    int doorsPerGroup = (doorCount + groups - 1) / groups;
+    int extraKeys = keyCount - groups;
+
+    int regionFirst = 0, regionCount = gen->floorCount; // behind first door of previous id
+    int group = -1, groupDoors = doorsPerGroup, id = -1;
+    int placed = 0;
+    for (int p = 0; p < pathLength && placed < doorCount; p++) {
+        // Selection sampling, doors are picked in order from the entry
+        if (randomBelow(gen, pathLength - p) >= doorCount - placed) continue;
+        int cell = gen->path[p];
+        if (gen->tiles[cell] != CHAR_VOID) continue;
+        if (groupDoors == doorsPerGroup) {
+            int at = gen->position[cell];
+            int key = pickFloor(gen, regionFirst, regionCount, at, gen->size[at]);
+            if (key < 0) continue; // no room for the key, try a deeper cell
+            group++;
+            id = gen->nextDoorId++;
+            gen->tiles[key] = CHAR_KEY;
+            gen->meta[key] = id;
+            int extra = extraKeys / groups + (group < extraKeys % groups);
+            for (int k = 0; k < extra && (key = pickFloor(gen, regionFirst, regionCount, at, gen->size[at])) >= 0; k++) {
+                gen->tiles[key] = CHAR_KEY;
+                gen->meta[key] = id;
+            }
+            regionFirst = at;
+            regionCount = gen->size[at];
+            gen->stage[at]++; // everything behind the door is one stage further, summed up later
+            gen->stage[at + gen->size[at]]--;
+            gen->stageCount++;
+            groupDoors = 0;
+        }
+        gen->tiles[cell] = CHAR_DOOR;
+        gen->meta[cell] = id;
+        groupDoors++;
+        placed++;
+    }
+}
+
+// Internal: build room r in gen->tiles and gen->meta.
+static void buildRoom(Generator *gen, int r) {
+    int width = gen->width;
+    int gridSize = (width - 1) / 2;
+    int entry = (2 * randomBelow(gen, gridSize) + 1) * width + 2 * randomBelow(gen, gridSize) + 1;
+    carveMaze(gen, entry);
+    for (int c = 0; c < gen->cells; c++) gen->meta[c] = -1;
+    walkMaze(gen, entry);
+
+    int exit = entry;
+    for (int i = 1; i < gen->floorCount; i++) {
+        if (gen->depth[gen->order[i]] > gen->depth[exit]) exit = gen->order[i];
+    }
+    int pathLength = gen->depth[exit] > 0 ? gen->depth[exit] - 1 : 0;
+    int p = pathLength;
+    for (int cell = gen->parent[exit]; cell >= 0 && cell != entry; cell = gen->parent[cell]) gen->path[--p] = cell;
+
+    int last = gen->options->roomCount - 1;
+    if (r == 0) {
+        gen->tiles[entry] = CHAR_START;
+    } else {
+        gen->tiles[entry] = CHAR_PASSAGE;
+        gen->meta[entry] = r - 1;
+    }
+    if (r == last) {
+        gen->tiles[exit] = CHAR_GOAL;
+    } else {
+        gen->tiles[exit] = CHAR_PASSAGE;
+        gen->meta[exit] = r;
+    }
+
+    memset(gen->stage, 0, (gen->floorCount + 1) * sizeof(int));
+    gen->stageCount = 1;
+    placeDoorsAndKeys(gen, pathLength);
+    for (int i = 1; i < gen->floorCount; i++) gen->stage[i] += gen->stage[i - 1];
+
+    // Extra passages join dead ends of the same stage: they shorten the way, but can't skip
+    // a door or block a corridor, and there is always a way back off their ends
+    int *pending = (int*)malloc(gen->stageCount * sizeof(int)); // dead end waiting for a pair, per stage
+    if (!pending) return;
+    for (int i = 0; i < gen->stageCount; i++) pending[i] = -1;
+    int ends = roundCount(gen->options->passageDensity, gen->floorCount);
+    int leafCount = 0;
+    for (int i = 1; i < gen->floorCount; i++) leafCount += gen->size[i] == 1;
+    for (int i = 1; i < gen->floorCount && ends > 0; i++) {
+        int cell = gen->order[i];
+        if (gen->size[i] != 1 || gen->tiles[cell] != CHAR_VOID) continue;
+        if (randomBelow(gen, leafCount) >= ends) continue;
+        int other = pending[gen->stage[i]];
+        if (other < 0) {
+            pending[gen->stage[i]] = cell;
+            continue;
+        }
+        gen->tiles[cell] = gen->tiles[other] = CHAR_PASSAGE;
+        gen->meta[cell] = gen->meta[other] = gen->nextPassageId++;
+        pending[gen->stage[i]] = -1;
+    }
+    free(pending);
+}
+
+// Internal: tiles of room followed by metadata of each row, the way the parser reads them.
+static int writeRoom(Generator *gen, FILE *out) {
+    int width = gen->width;
+    for (int y = 0; y < width; y++) {
+        const char *row = gen->tiles + y * width;
+        if (fwrite(row, 1, width, out) != (size_t)width) return 0;
+        for (int x = 0; x < width; x++) {
+            if (HAS_METADATA(row[x])) fprintf(out, " %d", gen->meta[y * width + x]);
+        }
+        if (fputc('\n', out) == EOF) return 0;
+    }
+    return 1;
+}
+
+void defaultGeneratorOptions(GeneratorOptions *options) {
+    options->width = 21;
+    options->roomCount = 3;
+    options->keyDensity = 0.01;
+    options->doorDensity = 0.05;
+    options->passageDensity = 0.005;
+    options->seed = 1;
+}
+
+// Write a random, always finishable level in .dat format. Same options give the same file.
+int generateLevel(FILE *out, const GeneratorOptions *options) {
+    if (options->width < GENERATE_MIN_WIDTH || options->width > GENERATE_MAX_WIDTH || options->roomCount <= 0) {
+        log_error("Invalid generator size: WIDTH %d, %d rooms.", options->width, options->roomCount);
+        return 0;
+    }
+    Generator gen;
+    memset(&gen, 0, sizeof(gen));
+    gen.rng = options->seed;
+    gen.options = options;
+    gen.width = options->width;
+    gen.cells = options->width * options->width;
+    gen.nextPassageId = options->roomCount - 1;
+    gen.tiles = (char*)malloc(gen.cells);
+    gen.meta = (int*)malloc(gen.cells * sizeof(int));
+    gen.order = (int*)malloc(gen.cells * sizeof(int));
+    gen.position = (int*)malloc(gen.cells * sizeof(int));
+    gen.size = (int*)malloc(gen.cells * sizeof(int));
+    gen.parent = (int*)malloc(gen.cells * sizeof(int));
+    gen.depth = (int*)malloc(gen.cells * sizeof(int));
+    gen.path = (int*)malloc(gen.cells * sizeof(int));
+    gen.stage = (int*)malloc((gen.cells + 1) * sizeof(int));
+    int ok = gen.tiles && gen.meta && gen.order && gen.position && gen.size && gen.parent && gen.depth && gen.path && gen.stage;
+    if (!ok) log_error("Failed to allocate generator for rooms of WIDTH %d.", options->width);
+
+    if (ok) {
+        fprintf(out, "; Generated level, seed %llu\n", (unsigned long long)options->seed);
+        fprintf(out, "; keys %g, doors %g, passages %g\n", options->keyDensity, options->doorDensity, options->passageDensity);
+        fprintf(out, "WIDTH %d\n\nBEGIN\n", options->width);
+    }
+    for (int r = 0; ok && r < options->roomCount; r++) {
+        buildRoom(&gen, r);
+        ok = writeRoom(&gen, out);
+    }
+    if (ok) ok = fputs("END\n", out) != EOF;
+
+    free(gen.tiles);
+    free(gen.meta);
+    free(gen.order);
+    free(gen.position);
+    free(gen.size);
+    free(gen.parent);
+    free(gen.depth);
+    free(gen.path);
+    free(gen.stage);
+    return ok;
+}
+
+// CLI: game.out --generate <level> [-w width] [-r rooms] [-k keys] [-d doors] [-p passages] [-s seed]
+// Writes LEVELS_FOLDER/<level>.dat, or standard output if level is "-".
+int generateCommand(int argc, char **argv) {
+    GeneratorOptions options;
+    defaultGeneratorOptions(&options);
+    int valid = argc >= 1 && argc % 2 == 1;
+    for (int i = 1; valid && i + 1 < argc; i += 2) {
+        const char *value = argv[i + 1];
+        if (strcmp(argv[i], "-w") == 0) options.width = atoi(value);
+        else if (strcmp(argv[i], "-r") == 0) options.roomCount = atoi(value);
+        else if (strcmp(argv[i], "-k") == 0) options.keyDensity = atof(value);
+        else if (strcmp(argv[i], "-d") == 0) options.doorDensity = atof(value);
+        else if (strcmp(argv[i], "-p") == 0) options.passageDensity = atof(value);
+        else if (strcmp(argv[i], "-s") == 0) options.seed = strtoull(value, NULL, 10);
+        else valid = 0;
+    }
+    if (valid && (options.width < GENERATE_MIN_WIDTH || options.width > GENERATE_MAX_WIDTH || options.roomCount <= 0)) {
+        fprintf(stderr, "WIDTH must be %d to %d and there must be at least one room.\n", GENERATE_MIN_WIDTH, GENERATE_MAX_WIDTH);
+        return 1;
+    }
+    if (!valid) {
+        fprintf(stderr, "Usage: --generate <level|-> [-w width] [-r rooms] [-k keys] [-d doors] [-p passages] [-s seed]\n");
+        return 1;
+    }
+
+    if (strcmp(argv[0], "-") == 0) {
+        return generateLevel(stdout, &options) ? 0 : 1;
+    }
+    char levelName[256];
+    char path[512];
+    parseLevelName(argv[0], levelName, sizeof(levelName));
+    snprintf(path, sizeof(path), "%s/%s.dat", LEVELS_FOLDER, levelName);
+    FILE *out = fopen(path, "wb");
+    if (!out) {
+        fprintf(stderr, "Failed to open '%s' for writing.\n", path);
+        return 1;
+    }
+    clock_t started = clock();
+    int ok = generateLevel(out, &options);
+    long size = ftell(out);
+    if (fclose(out) != 0) ok = 0;
+    if (!ok) {
+        fprintf(stderr, "Failed to generate level, see log.\n");
+        remove(path);
+        return 1;
+    }
+    double seconds = (double)(clock() - started) / CLOCKS_PER_SEC;
+    printf("%s: WIDTH %d, %d rooms, %ld bytes in %.3fs\n", path, options.width, options.roomCount, size, seconds);
+    log_info("Generated level %s (seed %llu, %ld bytes)", levelName, (unsigned long long)options.seed, size);
+    return 0;
+}
@@ -0,0 +1,129 @@
+#include "journal.h"
+#include "binio.h"
+#include "savesdir.h"
+#include "loglib.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+static FILE *journalFile = NULL;
+static char *journalLevel = NULL;
+static int pendingMoves = 0; // appended since last flush
+static int unsyncedMoves = 0; // flushed since last fsync
+static time_t lastSync = 0;
+
+void journalPath(char *buf, size_t bufsz, const char *levelName) {
+    snprintf(buf, bufsz, GAMES_FOLDER"/%s/"ONGOING_FOLDER"/"JOURNAL_FILE, levelName);
+}
+
+void keptJournalPath(char *buf, size_t bufsz, const char *levelName) {
+    snprintf(buf, bufsz, GAMES_FOLDER"/%s/"ONGOING_FOLDER"/"JOURNAL_KEPT_FILE, levelName);
+}
+
+// Is there a journal left behind for level, e.g. by a crash.
+int findJournal(const char *levelName) {
+    char path[256];
+    journalPath(path, sizeof(path), levelName);
+    return findData(path);
+}
+
+int isJournalOpen(void) {
+    return journalFile != NULL;
+}
+
+// Start a fresh journal for level, holding moves made so far. resumedPath is
+// the journal the game was resumed from, NULL for a new game. A journal left
+// by a crash that isn't the resumed one is moved to JOURNAL_KEPT_FILE first.
+int startJournal(const char *levelName, uint32_t levelHash, const char *moves, int count, const char *resumedPath) {
+    closeJournal(1); // a new game replaces the journal of this session
+
+    char dirPath[256];
+    snprintf(dirPath, sizeof(dirPath), GAMES_FOLDER"/%s/"ONGOING_FOLDER, levelName);
+    createDirectories(dirPath);
+    char path[256];
+    char keptPath[256];
+    journalPath(path, sizeof(path), levelName);
+    keptJournalPath(keptPath, sizeof(keptPath), levelName);
+    int resumedKept = resumedPath && strcmp(resumedPath, keptPath) == 0;
+    if ((!resumedPath || resumedKept) && findData(path)) {
+        remove(keptPath); // only one is kept, the resumed one is in memory already
+        if (rename(path, keptPath) != 0) {
+            log_warn("Failed to keep autosave journal %s, playing without one (errno: %d)", path, errno);
+            return 0;
+        }
+        log_warn("Kept autosave journal of an earlier game as %s", keptPath);
+        resumedKept = 0;
+    }
+    journalFile = fopen(path, "wb");
+    if (!journalFile) {
+        log_warn("Failed to open autosave journal: %s (errno: %d)", path, errno);
+        return 0;
+    }
+    journalLevel = strdup(levelName);
+    int ok = journalLevel && writeJournalHeader(journalFile, levelHash);
+    if (ok && count > 0) ok = fwrite(moves, 1, (size_t)count, journalFile) == (size_t)count;
+    if (ok) ok = syncFile(journalFile);
+    if (!ok) {
+        log_warn("Failed to write autosave journal: %s", path);
+        closeJournal(1);
+        return 0;
+    }
+    pendingMoves = 0;
+    unsyncedMoves = 0;
+    lastSync = time(NULL);
+    if (resumedKept) deleteData(keptPath); // its moves live on in the new journal
+    noteLocalFolderChange(levelName, 0);
+    return 1;
+}
+
+// Record one accepted move, written out once JOURNAL_FLUSH_MOVES are pending.
+void appendJournal(char move) {
+    if (!journalFile) return;
+    fputc(move, journalFile); // lands in stdio buffer
+    if (++pendingMoves >= JOURNAL_FLUSH_MOVES) flushJournal();
+}
+
+// Write pending moves to the file, fsync if JOURNAL_SYNC_SECONDS passed since last one.
+// Called before the game waits for input, so an idle game has nothing in memory.
+void flushJournal(void) {
+    if (!journalFile) return;
+    if (pendingMoves) {
+        if (fflush(journalFile) != 0) log_warn("Failed to write autosave journal (errno: %d)", errno);
+        unsyncedMoves += pendingMoves;
+        pendingMoves = 0;
+    }
+    time_t now = time(NULL);
+    if (unsyncedMoves && difftime(now, lastSync) >= JOURNAL_SYNC_SECONDS) {
+        syncFile(journalFile);
+        unsyncedMoves = 0;
+        lastSync = now;
+    }
+}
+
+// Drop moves past the first count, after they were undone.
+void truncateJournal(int count) {
+    if (!journalFile) return;
+    if (!truncateFile(journalFile, SAVE_HEADER_SIZE + (long)count)) {
+        log_warn("Failed to truncate autosave journal (errno: %d)", errno);
+    }
+    unsyncedMoves += pendingMoves + 1; // new length is synced with the next flush
+    pendingMoves = 0;
+}
+
+// Stop journaling, discard removes the file as the game ended normally.
+void closeJournal(int discard) {
+    if (!journalFile) return;
+    if (!discard) syncFile(journalFile);
+    fclose(journalFile);
+    journalFile = NULL;
+    if (discard && journalLevel) {
+        char path[256];
+        journalPath(path, sizeof(path), journalLevel);
+        deleteData(path);
+        noteLocalFolderChange(journalLevel, 0);
+    }
+    free(journalLevel);
+    journalLevel = NULL;
+    pendingMoves = 0;
+    unsyncedMoves = 0;
+}
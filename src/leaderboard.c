@@ -0,0 +1,89 @@
+#include "leaderboard.h"
+#include "savesdir.h"
+#include "loglib.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Sorted finished games per level, built on first use after local data changed
+static int builtVersion = -1;
+static int builtLevels = 0;
+static LeaderboardEntry **boards = NULL;
+
+static int compareEntries(const void *a, const void *b) {
+    const LeaderboardEntry *ea = (const LeaderboardEntry*)a;
+    const LeaderboardEntry *eb = (const LeaderboardEntry*)b;
+    // Unreadable saves (-1) go last
+    if ((ea->moves < 0) != (eb->moves < 0)) return (ea->moves < 0) ? 1 : -1;
+    if (ea->moves != eb->moves) return (ea->moves < eb->moves) ? -1 : 1;
+    return strcmp(ea->name, eb->name);
+}
+
+void freeLeaderboards(void) {
+    for (int i = 0; i < builtLevels; i++) free(boards[i]);
+    free(boards);
+    boards = NULL;
+    builtLevels = 0;
+    builtVersion = -1;
+}
+
+// Internal: sorted entries of level, NULL if level has none or on failure.
+static const LeaderboardEntry *levelBoard(int levelIndex) {
+    if (!localDataLoaded || levelIndex < 0 || levelIndex >= levelCount) return NULL;
+    if (builtVersion != localDataVersion) {
+        freeLeaderboards();
+        boards = calloc(levelCount, sizeof(LeaderboardEntry*));
+        if (!boards) return NULL;
+        builtLevels = levelCount;
+        builtVersion = localDataVersion;
+    }
+    if (boards[levelIndex]) return boards[levelIndex];
+
+    int count = finishedGameCounts[levelIndex];
+    if (count <= 0) return NULL;
+    LeaderboardEntry *board = malloc(count * sizeof(LeaderboardEntry));
+    if (!board) {
+        log_error("Failed to allocate leaderboard of %d entries.", count);
+        return NULL;
+    }
+    for (int i = 0; i < count; i++) {
+        board[i].name = finishedPlayerNames[levelIndex][i] ? finishedPlayerNames[levelIndex][i] : "";
+        board[i].moves = finishedMovesCounts[levelIndex][i];
+    }
+    qsort(board, count, sizeof(LeaderboardEntry), compareEntries);
+    for (int i = 0; i < count; i++) {
+        int tied = i > 0 && board[i].moves == board[i - 1].moves;
+        board[i].rank = tied ? board[i - 1].rank : i + 1;
+    }
+    boards[levelIndex] = board;
+    return board;
+}
+
+int leaderboardCount(int levelIndex) {
+    if (!localDataLoaded || levelIndex < 0 || levelIndex >= levelCount) return 0;
+    return finishedGameCounts[levelIndex];
+}
+
+// Copy entries [first, first + count) in ranking order, returns how many were copied.
+int leaderboardPage(int levelIndex, int first, int count, LeaderboardEntry *out) {
+    const LeaderboardEntry *board = levelBoard(levelIndex);
+    if (!board || first < 0) return 0;
+    int total = finishedGameCounts[levelIndex];
+    if (first >= total) return 0;
+    if (count > total - first) count = total - first;
+    memcpy(out, board + first, count * sizeof(LeaderboardEntry));
+    return count;
+}
+
+int leaderboardTop(int levelIndex, int k, LeaderboardEntry *out) {
+    return leaderboardPage(levelIndex, 0, k, out);
+}
+
+// Rank of player on level, 0 if player has no finished game there.
+int leaderboardRank(int levelIndex, const char *playerName) {
+    const LeaderboardEntry *board = levelBoard(levelIndex);
+    if (!board) return 0;
+    for (int i = 0; i < finishedGameCounts[levelIndex]; i++) {
+        if (strcmp(board[i].name, playerName) == 0) return board[i].rank;
+    }
+    return 0;
+}
@@ -0,0 +1,536 @@
+#include "level.h"
+#include "binio.h"
+#include "loglib.h"
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+#include <stdarg.h>
+
+typedef struct {
+    int id;
+    size_t cell;
+} IdEntry;
+
+static void freeIdIndex(IdIndex *index) {
+    free(index->ids);
+    free(index->starts);
+    free(index->counts);
+    free(index->cells);
+    free(index->hash);
+    memset(index, 0, sizeof(*index));
+}
+
+static unsigned int hashId(int id) {
+    return (unsigned int)id * 2654435761u;
+}
+
+static int compareIdEntries(const void *a, const void *b) {
+    const IdEntry *ea = (const IdEntry*)a;
+    const IdEntry *eb = (const IdEntry*)b;
+    if (ea->id != eb->id) return (ea->id < eb->id) ? -1 : 1;
+    if (ea->cell != eb->cell) return (ea->cell < eb->cell) ? -1 : 1;
+    return 0;
+}
+
+// Internal: group all tiles of given symbol by id. Flagged tiles (-2) are left out.
+static int fillIdIndex(IdIndex *index, const Level *level, char symbol) {
+    memset(index, 0, sizeof(*index));
+    size_t cells = LEVEL_SIZE(level);
+
+    int entryCount = 0;
+    for (size_t c = 0; c < cells; c++) {
+        if (level->tiles[c] == symbol && level->meta[c] != -2) entryCount++;
+    }
+
+    IdEntry *entries = NULL;
+    if (entryCount > 0) {
+        entries = (IdEntry*)malloc(entryCount * sizeof(IdEntry));
+        index->cells = (size_t*)malloc(entryCount * sizeof(size_t));
+        if (!entries || !index->cells) goto fail;
+    }
+    int e = 0;
+    for (size_t c = 0; c < cells; c++) {
+        if (level->tiles[c] == symbol && level->meta[c] != -2) {
+            entries[e].id = level->meta[c];
+            entries[e].cell = c;
+            e++;
+        }
+    }
+    if (entryCount > 1) qsort(entries, entryCount, sizeof(IdEntry), compareIdEntries);
+
+    int groups = 0;
+    for (int i = 0; i < entryCount; i++) {
+        if (i == 0 || entries[i].id != entries[i - 1].id) groups++;
+    }
+
+    int tableSize = 8;
+    while (tableSize < groups * 2) tableSize *= 2;
+    index->hashMask = tableSize - 1;
+    index->hash = (int*)malloc(tableSize * sizeof(int));
+    if (!index->hash) goto fail;
+    for (int i = 0; i < tableSize; i++) index->hash[i] = -1;
+
+    if (groups > 0) {
+        index->ids = (int*)malloc(groups * sizeof(int));
+        index->starts = (int*)malloc(groups * sizeof(int));
+        index->counts = (int*)calloc(groups, sizeof(int));
+        if (!index->ids || !index->starts || !index->counts) goto fail;
+    }
+
+    int g = -1;
+    for (int i = 0; i < entryCount; i++) {
+        if (i == 0 || entries[i].id != entries[i - 1].id) {
+            g++;
+            index->ids[g] = entries[i].id;
+            index->starts[g] = i;
+            unsigned int slot = hashId(entries[i].id) & index->hashMask;
+            while (index->hash[slot] != -1) slot = (slot + 1) & index->hashMask;
+            index->hash[slot] = g;
+        }
+        index->cells[i] = entries[i].cell;
+        index->counts[g]++;
+    }
+    index->groupCount = groups;
+
+    free(entries);
+    return 1;
+
+fail:
+    free(entries);
+    freeIdIndex(index);
+    return 0;
+}
+
+int allocLevel(Level *level, int width, int roomCount) {
+    memset(level, 0, sizeof(*level));
+    if (width <= 0 || roomCount <= 0) return 0;
+
+    size_t cells = (size_t)roomCount * width * width;
+    level->tiles = (char*)malloc(cells * sizeof(char));
+    level->meta = (int*)malloc(cells * sizeof(int));
+    level->special = (unsigned char*)calloc((cells + 7) / 8, 1);
+    if (!level->tiles || !level->meta || !level->special) {
+        freeLevel(level);
+        return 0;
+    }
+    level->width = width;
+    level->roomCount = roomCount;
+    return 1;
+}
+
+void freeLevel(Level *level) {
+    free(level->tiles);
+    free(level->meta);
+    free(level->special);
+    freeIdIndex(&level->doors);
+    freeIdIndex(&level->keys);
+    freeIdIndex(&level->passages);
+    memset(level, 0, sizeof(*level));
+}
+
+// Find group of given id, -1 if there is none.
+int findIdGroupIndex(const IdIndex *index, int id) {
+    if (!index->hash) return -1;
+    unsigned int slot = hashId(id) & index->hashMask;
+    while (index->hash[slot] != -1) {
+        int g = index->hash[slot];
+        if (index->ids[g] == id) return g;
+        slot = (slot + 1) & index->hashMask;
+    }
+    return -1;
+}
+
+// Find cells of tiles with given id, NULL if there are none.
+const size_t *findIdGroup(const IdIndex *index, int id, int *count) {
+    int g = findIdGroupIndex(index, id);
+    if (g < 0) {
+        *count = 0;
+        return NULL;
+    }
+    *count = index->counts[g];
+    return index->cells + index->starts[g];
+}
+
+// Source line of a cell, 0 when lines are unknown
+#define CELL_LINE(level, rowLines, cell) ((rowLines) ? (rowLines)[(cell) / (size_t)(level)->width] : 0)
+
+static int indexLevel(Level *level, const LevelDiagnostics *diagnostics, const int *rowLines);
+static void checkIndex(const Level *level, const LevelDiagnostics *diagnostics, const int *rowLines);
+
+// Build door, key and passage indexes from tiles and metadata, and report
+// ids that can never work (keys without doors, passages without a pair).
+int buildLevelIndex(Level *level) {
+    return indexLevel(level, NULL, NULL);
+}
+
+// Log keys without doors and passages without a pair, for levels whose
+// index came from the compiled level cache instead of buildLevelIndex().
+void checkLevelIndex(const Level *level) {
+    checkIndex(level, NULL, NULL);
+}
+
+// Internal: pass problem to diagnostics sink, or log it when there is none.
+static void reportLevel(const LevelDiagnostics *diagnostics, int severity, int line, const char *format, ...) {
+    char message[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    if (diagnostics && diagnostics->report) {
+        diagnostics->report(diagnostics->context, severity, line, message);
+    } else if (severity == LEVEL_DIAG_ERROR) {
+        log_error("%s", message);
+    } else {
+        log_warn("%s", message);
+    }
+}
+
+// Internal: report keys without doors and passages without a pair.
+static void checkIndex(const Level *level, const LevelDiagnostics *diagnostics, const int *rowLines) {
+    for (int g = 0; g < level->keys.groupCount; g++) {
+        int id = level->keys.ids[g];
+        int doorCount;
+        if (id != -1 && !findIdGroup(&level->doors, id, &doorCount)) {
+            reportLevel(diagnostics, LEVEL_DIAG_WARNING, CELL_LINE(level, rowLines, level->keys.cells[level->keys.starts[g]]),
+                "Key %d does not open any doors.", id);
+        }
+    }
+    for (int g = 0; g < level->passages.groupCount; g++) {
+        int line = CELL_LINE(level, rowLines, level->passages.cells[level->passages.starts[g]]);
+        if (level->passages.counts[g] < 2) {
+            reportLevel(diagnostics, LEVEL_DIAG_ERROR, line, "Passage %d is not paired.", level->passages.ids[g]);
+        } else if (level->passages.counts[g] > 2) {
+            reportLevel(diagnostics, LEVEL_DIAG_WARNING, line, "Passage %d has %d ends, extra ends lead to the first one.", level->passages.ids[g], level->passages.counts[g]);
+        }
+    }
+}
+
+// Internal: buildLevelIndex() reporting to diagnostics, rowLines maps rows to source lines if given.
+static int indexLevel(Level *level, const LevelDiagnostics *diagnostics, const int *rowLines) {
+    if (!fillIdIndex(&level->doors, level, CHAR_DOOR) ||
+        !fillIdIndex(&level->keys, level, CHAR_KEY) ||
+        !fillIdIndex(&level->passages, level, CHAR_PASSAGE)) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, 0, "Failed to allocate id index for level.");
+        return 0;
+    }
+
+    // Goals, unused keys and passages, everything else is skipped by step()
+    size_t cells = LEVEL_SIZE(level);
+    memset(level->special, 0, (cells + 7) / 8);
+    for (size_t i = 0; i < cells; i++) {
+        char tile = level->tiles[i];
+        int id = level->meta[i];
+        if (tile == CHAR_GOAL || ((tile == CHAR_KEY || tile == CHAR_PASSAGE) && id != -1 && id != -2)) {
+            LEVEL_SET_SPECIAL(level, i);
+        }
+    }
+
+    checkIndex(level, diagnostics, rowLines);
+    return 1;
+}
+
+// Streaming level parser, one line at a time straight into level storage
+enum { PARSE_WIDTH, PARSE_BEGIN, PARSE_ROOMS, PARSE_DONE };
+
+typedef struct {
+    Level *level;
+    const LevelDiagnostics *diagnostics;
+    int state;
+    int failed;
+    int lineNumber;
+    int *rowLines;     // source line of each row read, for diagnostics
+    int metaLine;      // line of the last metadata value of the room in progress
+    int roomCapacity;  // rooms allocated in tiles, meta and rowLines
+    int row;           // rows read of the room in progress
+    int tileLines;
+    int *roomMeta;     // metadata values of the room in progress, in order
+    int roomMetaCount;
+    int roomMetaCap;
+    int foundStart;
+    int foundGoal;
+    int startR, startY, startX;
+    int extraStartLine; // line of the second start tile
+} LevelParser;
+
+// Internal: make room for one more room behind the complete ones, doubling the allocation.
+static int reserveRoom(LevelParser *parser) {
+    Level *level = parser->level;
+    if (level->roomCount < parser->roomCapacity) return 1;
+    if (parser->roomCapacity > INT_MAX / 2) return 0;
+    int capacity = parser->roomCapacity ? parser->roomCapacity * 2 : 4;
+    size_t cells = (size_t)capacity * LEVEL_ROOM_SIZE(level);
+    if (cells / capacity != LEVEL_ROOM_SIZE(level) || cells > SIZE_MAX / sizeof(int)) return 0;
+    char *tiles = (char*)realloc(level->tiles, cells * sizeof(char));
+    if (!tiles) return 0;
+    level->tiles = tiles;
+    int *meta = (int*)realloc(level->meta, cells * sizeof(int));
+    if (!meta) return 0;
+    level->meta = meta;
+    int *rowLines = (int*)realloc(parser->rowLines, (size_t)capacity * level->width * sizeof(int));
+    if (!rowLines) return 0;
+    parser->rowLines = rowLines;
+    parser->roomCapacity = capacity;
+    return 1;
+}
+
+static int pushRoomMeta(LevelParser *parser, int value) {
+    if (parser->roomMetaCount == parser->roomMetaCap) {
+        int capacity = parser->roomMetaCap ? parser->roomMetaCap * 2 : 16;
+        int *grown = (int*)realloc(parser->roomMeta, capacity * sizeof(int));
+        if (!grown) return 0;
+        parser->roomMeta = grown;
+        parser->roomMetaCap = capacity;
+    }
+    parser->roomMeta[parser->roomMetaCount++] = value;
+    return 1;
+}
+
+// Internal: hand out metadata of a complete room to its tiles in scan order.
+static void finishRoom(LevelParser *parser) {
+    Level *level = parser->level;
+    int r = level->roomCount;
+    int metaIndex = 0;
+    for (int i = 0; i < level->width; ++i) {
+        for (int j = 0; j < level->width; ++j) {
+            char ch = LEVEL_TILE(level, r, i, j);
+            if (HAS_METADATA(ch)) {
+                if (metaIndex < parser->roomMetaCount) {
+                    LEVEL_META(level, r, i, j) = parser->roomMeta[metaIndex++];
+                } else {
+                    reportLevel(parser->diagnostics, LEVEL_DIAG_ERROR, parser->rowLines[r * level->width + i],
+                        "No metadata found for tile '%c' at (%d, %d) in room %d.", ch, j, i, r);
+                    LEVEL_META(level, r, i, j) = -2;
+                }
+            } else {
+                LEVEL_META(level, r, i, j) = -1;
+            }
+            // Locate start and goal tiles
+            if (ch == CHAR_START) {
+                parser->startR = r;
+                parser->startY = i;
+                parser->startX = j;
+                if (++parser->foundStart == 2) parser->extraStartLine = parser->rowLines[r * level->width + i];
+            }
+            if (ch == CHAR_GOAL) {
+                parser->foundGoal = 1;
+            }
+        }
+    }
+    if (metaIndex < parser->roomMetaCount) {
+        reportLevel(parser->diagnostics, LEVEL_DIAG_WARNING, parser->metaLine,
+            "Excess metadata in room %d, last %d value(s) ignored.", r, parser->roomMetaCount - metaIndex);
+    }
+    level->roomCount++;
+    parser->row = 0;
+    parser->roomMetaCount = 0;
+}
+
+// Internal: tiles of one row go straight into the level, trailing metadata is kept until the room is complete.
+static void parseRoomRow(LevelParser *parser, const char *row, size_t length) {
+    Level *level = parser->level;
+    int width = level->width;
+    if (parser->row == 0 && !reserveRoom(parser)) {
+        reportLevel(parser->diagnostics, LEVEL_DIAG_ERROR, parser->lineNumber, "Failed to allocate memory for level rooms.");
+        parser->failed = 1;
+        return;
+    }
+    int r = level->roomCount;
+    parser->rowLines[r * width + parser->row] = parser->lineNumber;
+    char *tiles = &LEVEL_TILE(level, r, parser->row, 0);
+    // first WIDTH characters are tile chars (pad with walls if short)
+    if (length < (size_t)width) {
+        memcpy(tiles, row, length);
+        memset(tiles + length, CHAR_WALL, width - length);
+        reportLevel(parser->diagnostics, LEVEL_DIAG_WARNING, parser->lineNumber,
+            "Line %d in room %d is shorter than WIDTH (%d). Padding with walls.", parser->lineNumber, r, width);
+    } else {
+        memcpy(tiles, row, width);
+    }
+    // Metadata values separated by spaces or tabs after first WIDTH chars
+    const char *end = row + length;
+    for (const char *p = row + (length < (size_t)width ? length : (size_t)width); p < end; ) {
+        while (p < end && (*p == ' ' || *p == '\t')) p++;
+        if (p == end) break;
+        if (!pushRoomMeta(parser, (int)strtol(p, NULL, 10))) {
+            reportLevel(parser->diagnostics, LEVEL_DIAG_ERROR, parser->lineNumber, "Failed to allocate memory for level metadata.");
+            parser->failed = 1;
+            return;
+        }
+        parser->metaLine = parser->lineNumber;
+        while (p < end && *p != ' ' && *p != '\t') p++;
+    }
+    parser->tileLines++;
+    if (++parser->row == width) finishRoom(parser);
+}
+
+// Internal: handle one line, line[length] must be writable.
+static void parseLevelLine(LevelParser *parser, char *line, size_t length) {
+    parser->lineNumber++;
+    char *p = line;
+    char *end = line + length;
+    // Trim leading and trailing whitespace
+    while (p < end && isspace((unsigned char)*p)) p++;
+    while (end > p && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    if (*p == ';') return;
+
+    switch (parser->state) {
+        case PARSE_WIDTH: {
+            if (*p == '\0') return;
+            long width;
+            char *endptr;
+            if (strncmp(p, "WIDTH", 5) == 0) {
+                width = atoi(p + 5);
+            } else {
+                width = strtol(p, &endptr, 10);
+                if (endptr == p) return;
+            }
+            if (width <= 0 || width > 0xFFFF) {
+                reportLevel(parser->diagnostics, LEVEL_DIAG_ERROR, parser->lineNumber, "Missing or invalid WIDTH in level file.");
+                parser->failed = 1;
+                return;
+            }
+            if (width > 32) {
+                reportLevel(parser->diagnostics, LEVEL_DIAG_WARNING, parser->lineNumber, "Rooms of high width might not fit in console window.");
+            }
+            parser->level->width = (int)width;
+            parser->state = PARSE_BEGIN;
+        } break;
+        case PARSE_BEGIN:
+            if (strcmp(p, "BEGIN") == 0) parser->state = PARSE_ROOMS;
+        break;
+        case PARSE_ROOMS:
+            if (strcmp(p, "END") == 0) {
+                parser->state = PARSE_DONE;
+            } else if (*p != '\0') { // Ignore empty lines
+                parseRoomRow(parser, p, (size_t)(end - p));
+            }
+        break;
+    }
+}
+
+// Internal: checks once the whole file was read, and final allocations.
+static int finishLevel(LevelParser *parser) {
+    Level *level = parser->level;
+    const LevelDiagnostics *diagnostics = parser->diagnostics;
+    if (parser->state == PARSE_WIDTH) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, 0, "Missing or invalid WIDTH in level file.");
+        return 0;
+    }
+    if (parser->tileLines == 0) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, 0, "No room data found between BEGIN and END.");
+        return 0;
+    }
+    if (parser->row != 0) {
+        reportLevel(diagnostics, LEVEL_DIAG_WARNING, parser->rowLines[level->roomCount * level->width],
+            "Number of tile lines (%d) is not a multiple of WIDTH (%d). Truncating excess lines.", parser->tileLines, level->width);
+    }
+    if (level->roomCount <= 0) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, 0, "No valid rooms found in level data.");
+        return 0;
+    }
+
+    // Give back rooms allocated ahead
+    size_t cells = LEVEL_SIZE(level);
+    char *tiles = (char*)realloc(level->tiles, cells * sizeof(char));
+    if (tiles) level->tiles = tiles;
+    int *meta = (int*)realloc(level->meta, cells * sizeof(int));
+    if (meta) level->meta = meta;
+    level->special = (unsigned char*)calloc((cells + 7) / 8, 1);
+    if (!level->special) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, 0, "Failed to allocate memory for level.");
+        return 0;
+    }
+
+    // Index doors, keys and passages by id
+    if (!indexLevel(level, diagnostics, parser->rowLines)) return 0;
+
+    // validate overall level
+    if (!parser->foundStart) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, 0, "No start tile '@' found in level data (any room).");
+        return 0;
+    }
+    if (parser->foundStart > 1) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, parser->extraStartLine, "Multiple start tiles '@' found in level data (%d).", parser->foundStart);
+        return 0;
+    }
+    if (!parser->foundGoal) {
+        reportLevel(diagnostics, LEVEL_DIAG_WARNING, 0, "No goal tile '$' found in level data (any room).");
+    }
+    return 1;
+}
+
+// Parse level source from file in LEVEL_READ_BLOCK sized reads. Lines inside a block are
+// parsed in place, only lines crossing a block end are copied. Hash of the whole file
+// (same as hashFile()) goes to out_hash. Problems go to diagnostics, or the log if it is NULL,
+// so the parser can run on several threads. On failure level is left for freeLevel().
+int parseLevel(FILE *file, Level *level, int *startR, int *startY, int *startX, uint32_t *out_hash,
+        const LevelDiagnostics *diagnostics) {
+    memset(level, 0, sizeof(*level));
+    LevelParser parser;
+    memset(&parser, 0, sizeof(parser));
+    parser.level = level;
+    parser.diagnostics = diagnostics;
+
+    char *block = (char*)malloc(LEVEL_READ_BLOCK + 1);
+    char *line = NULL;  // line crossing block end
+    size_t lineLength = 0, lineCap = 0;
+    uint32_t hash = HASH_SEED;
+    int ok = block != NULL;
+    size_t got;
+    while (ok && (got = fread(block, 1, LEVEL_READ_BLOCK, file)) > 0) {
+        hash = hashData(hash, block, got);
+        char *p = block;
+        char *blockEnd = block + got;
+        while (p < blockEnd && parser.state != PARSE_DONE && !parser.failed) {
+            char *newline = (char*)memchr(p, '\n', (size_t)(blockEnd - p));
+            char *stop = newline ? newline : blockEnd;
+            size_t length = (size_t)(stop - p);
+            if (!newline || lineLength) {
+                if (lineLength + length + 1 > lineCap) {
+                    size_t capacity = lineCap ? lineCap : 256;
+                    while (capacity < lineLength + length + 1) capacity *= 2;
+                    char *grown = (char*)realloc(line, capacity);
+                    if (!grown) {
+                        reportLevel(diagnostics, LEVEL_DIAG_ERROR, parser.lineNumber + 1, "Failed to allocate memory for level line.");
+                        ok = 0;
+                        break;
+                    }
+                    line = grown;
+                    lineCap = capacity;
+                }
+                memcpy(line + lineLength, p, length);
+                lineLength += length;
+                if (!newline) break;
+                parseLevelLine(&parser, line, lineLength);
+                lineLength = 0;
+            } else {
+                parseLevelLine(&parser, p, length);
+            }
+            p = newline + 1;
+        }
+        if (parser.failed) ok = 0;
+        // After END the rest is only hashed
+    }
+    if (ok && ferror(file)) {
+        reportLevel(diagnostics, LEVEL_DIAG_ERROR, 0, "Failed to read level file (errno: %d)", errno);
+        ok = 0;
+    }
+    if (ok && lineLength && parser.state != PARSE_DONE) {
+        parseLevelLine(&parser, line, lineLength); // last line without newline
+        if (parser.failed) ok = 0;
+    }
+    if (ok) ok = finishLevel(&parser);
+    if (ok) {
+        *startR = parser.startR;
+        *startY = parser.startY;
+        *startX = parser.startX;
+        if (out_hash) *out_hash = hash;
+    }
+    free(block);
+    free(line);
+    free(parser.roomMeta);
+    free(parser.rowLines);
+    return ok;
+}
@@ -0,0 +1,239 @@
+#include "levelcache.h"
+#include "binio.h"
+#include "loglib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+// Cache is only read back on the machine that wrote it, so data is stored
+// in native layout and the header records enough to reject a foreign one.
+typedef struct {
+    char magic[4];
+    uint8_t version;
+    uint8_t intSize;
+    uint8_t sizeSize;
+    uint8_t reserved;
+    uint32_t byteOrder; // 0x01020304 as written
+    uint32_t headerSize;
+    uint32_t sourceHash;
+    uint32_t bodyHash;  // hashData of everything after the header
+    int64_t sourceMtime;
+    int64_t sourceSize;
+    int32_t width;
+    int32_t roomCount;
+    int32_t startR;
+    int32_t startY;
+    int32_t startX;
+} LevelCacheHeader;
+
+#define LEVEL_CACHE_BYTE_ORDER 0x01020304u
+
+static void cachePath(char *buf, size_t bufsz, const char *levelName) {
+    snprintf(buf, bufsz, LEVEL_CACHE_FOLDER"/%s.lvl", levelName);
+}
+
+int statLevelSource(const char *path, LevelSource *source) {
+    memset(source, 0, sizeof(*source));
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    source->mtime = (int64_t)st.st_mtime;
+    source->size = (int64_t)st.st_size;
+    return 1;
+}
+
+// Internal: sizes of the three index arrays that vary per level.
+static size_t indexCellCount(const IdIndex *index) {
+    if (index->groupCount == 0) return 0;
+    int last = index->groupCount - 1;
+    return (size_t)index->starts[last] + (size_t)index->counts[last];
+}
+
+static size_t indexBytes(const IdIndex *index) {
+    return 3 * sizeof(int)
+        + 3 * (size_t)index->groupCount * sizeof(int)
+        + indexCellCount(index) * sizeof(size_t)
+        + ((size_t)index->hashMask + 1) * sizeof(int);
+}
+
+static unsigned char *put(unsigned char *at, const void *data, size_t size) {
+    if (size) memcpy(at, data, size);
+    return at + size;
+}
+
+static unsigned char *putIndex(unsigned char *at, const IdIndex *index) {
+    int cellCount = (int)indexCellCount(index);
+    at = put(at, &index->groupCount, sizeof(int));
+    at = put(at, &index->hashMask, sizeof(int));
+    at = put(at, &cellCount, sizeof(int));
+    at = put(at, index->ids, index->groupCount * sizeof(int));
+    at = put(at, index->starts, index->groupCount * sizeof(int));
+    at = put(at, index->counts, index->groupCount * sizeof(int));
+    at = put(at, index->cells, (size_t)cellCount * sizeof(size_t));
+    return put(at, index->hash, ((size_t)index->hashMask + 1) * sizeof(int));
+}
+
+// Write compiled level next to the sources, failures only cost the next load a parse.
+int storeLevelCache(const char *levelName, const LevelSource *source, const Level *level, int startR, int startY, int startX) {
+    size_t cells = LEVEL_SIZE(level);
+    size_t size = sizeof(LevelCacheHeader) + cells + cells * sizeof(int) + (cells + 7) / 8
+        + indexBytes(&level->doors) + indexBytes(&level->keys) + indexBytes(&level->passages);
+    unsigned char *bytes = (unsigned char*)malloc(size);
+    if (!bytes) return 0;
+
+    LevelCacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LEVEL_CACHE_MAGIC, 4);
+    header.version = LEVEL_CACHE_VERSION;
+    header.intSize = sizeof(int);
+    header.sizeSize = sizeof(size_t);
+    header.byteOrder = LEVEL_CACHE_BYTE_ORDER;
+    header.headerSize = sizeof(LevelCacheHeader);
+    header.sourceHash = source->hash;
+    header.sourceMtime = source->mtime;
+    header.sourceSize = source->size;
+    header.width = level->width;
+    header.roomCount = level->roomCount;
+    header.startR = startR;
+    header.startY = startY;
+    header.startX = startX;
+
+    unsigned char *at = put(bytes, &header, sizeof(header));
+    at = put(at, level->tiles, cells);
+    at = put(at, level->meta, cells * sizeof(int));
+    at = put(at, level->special, (cells + 7) / 8);
+    at = putIndex(at, &level->doors);
+    at = putIndex(at, &level->keys);
+    putIndex(at, &level->passages);
+    header.bodyHash = hashData(HASH_SEED, bytes + sizeof(header), size - sizeof(header));
+    memcpy(bytes, &header, sizeof(header));
+
+    char path[256];
+    cachePath(path, sizeof(path), levelName);
+    int ok = writeFileAtomic(path, bytes, size);
+    free(bytes);
+    if (ok) log_info("Compiled level %s to %s", levelName, path);
+    return ok;
+}
+
+// Internal: copy next size bytes of cache, 0 if cache ends early.
+static int take(const unsigned char **at, size_t *left, void *out, size_t size) {
+    if (size > *left) return 0;
+    if (size) memcpy(out, *at, size);
+    *at += size;
+    *left -= size;
+    return 1;
+}
+
+// Internal: allocate and copy count elements, NULL array when count is 0.
+static int takeArray(const unsigned char **at, size_t *left, void **out, size_t count, size_t elementSize) {
+    *out = NULL;
+    if (count == 0) return 1;
+    if (count > *left / elementSize) return 0;
+    *out = malloc(count * elementSize);
+    return *out && take(at, left, *out, count * elementSize);
+}
+
+// Internal: read one IdIndex, checking it only points inside a level of given size.
+static int takeIndex(const unsigned char **at, size_t *left, IdIndex *index, size_t levelCells) {
+    int cellCount;
+    memset(index, 0, sizeof(*index));
+    if (!take(at, left, &index->groupCount, sizeof(int)) ||
+        !take(at, left, &index->hashMask, sizeof(int)) ||
+        !take(at, left, &cellCount, sizeof(int))) return 0;
+    if (index->groupCount < 0 || cellCount < 0 || index->hashMask < 0) return 0;
+    if (((index->hashMask + 1) & index->hashMask) != 0) return 0;
+    if (!takeArray(at, left, (void**)&index->ids, index->groupCount, sizeof(int))
+        || !takeArray(at, left, (void**)&index->starts, index->groupCount, sizeof(int))
+        || !takeArray(at, left, (void**)&index->counts, index->groupCount, sizeof(int))
+        || !takeArray(at, left, (void**)&index->cells, cellCount, sizeof(size_t))
+        || !takeArray(at, left, (void**)&index->hash, (size_t)index->hashMask + 1, sizeof(int))) return 0;
+
+    for (int g = 0; g < index->groupCount; g++) {
+        if (index->starts[g] < 0 || index->counts[g] < 0 || index->starts[g] > cellCount - index->counts[g]) return 0;
+    }
+    for (int i = 0; i < cellCount; i++) {
+        if (index->cells[i] >= levelCells) return 0;
+    }
+    for (int i = 0; i <= index->hashMask; i++) {
+        if (index->hash[i] < -1 || index->hash[i] >= index->groupCount) return 0;
+    }
+    return 1;
+}
+
+// Load compiled level if it was made from source as it is now. source needs
+// mtime and size from statLevelSource, its hash is filled in on success.
+// Returns 0 when there is no usable cache, level is then left empty.
+int loadLevelCache(const char *levelName, const char *sourcePath, LevelSource *source, Level *level, int *startR, int *startY, int *startX) {
+    char path[256];
+    cachePath(path, sizeof(path), levelName);
+    FILE *file = fopen(path, "rb");
+    if (!file) return 0;
+
+    unsigned char *bytes = NULL;
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+    if (size > (long)sizeof(LevelCacheHeader) && fseek(file, 0, SEEK_SET) == 0) {
+        bytes = (unsigned char*)malloc((size_t)size);
+        if (bytes && fread(bytes, 1, (size_t)size, file) != (size_t)size) {
+            free(bytes);
+            bytes = NULL;
+        }
+    }
+    fclose(file);
+    if (!bytes) return 0;
+
+    const unsigned char *at = bytes;
+    size_t left = (size_t)size;
+    LevelCacheHeader header;
+    take(&at, &left, &header, sizeof(header));
+    int valid = memcmp(header.magic, LEVEL_CACHE_MAGIC, 4) == 0
+        && header.version == LEVEL_CACHE_VERSION
+        && header.intSize == sizeof(int) && header.sizeSize == sizeof(size_t)
+        && header.byteOrder == LEVEL_CACHE_BYTE_ORDER
+        && header.headerSize == sizeof(LevelCacheHeader)
+        && header.sourceSize == source->size
+        && header.bodyHash == hashData(HASH_SEED, at, left);
+    if (valid && header.sourceMtime != source->mtime) {
+        // Touched but maybe not changed, hash decides
+        uint32_t hash;
+        valid = hashFile(sourcePath, &hash) && hash == header.sourceHash;
+        if (valid) {
+            // Remember new time, so next load doesn't hash again
+            header.sourceMtime = source->mtime;
+            memcpy(bytes, &header, sizeof(header));
+            writeFileAtomic(path, bytes, (size_t)size);
+        }
+    }
+    if (!valid) {
+        free(bytes);
+        log_info("Level cache %s is stale or damaged, recompiling.", path);
+        return 0;
+    }
+
+    int ok = allocLevel(level, header.width, header.roomCount);
+    if (ok) {
+        size_t cells = LEVEL_SIZE(level);
+        ok = take(&at, &left, level->tiles, cells)
+            && take(&at, &left, level->meta, cells * sizeof(int))
+            && take(&at, &left, level->special, (cells + 7) / 8)
+            && takeIndex(&at, &left, &level->doors, cells)
+            && takeIndex(&at, &left, &level->keys, cells)
+            && takeIndex(&at, &left, &level->passages, cells)
+            && left == 0
+            && header.startR >= 0 && header.startR < level->roomCount
+            && header.startY >= 0 && header.startY < level->width
+            && header.startX >= 0 && header.startX < level->width;
+    }
+    free(bytes);
+    if (!ok) {
+        freeLevel(level);
+        log_warn("Level cache %s is damaged, recompiling.", path);
+        return 0;
+    }
+    source->hash = header.sourceHash;
+    *startR = header.startR;
+    *startY = header.startY;
+    *startX = header.startX;
+    return 1;
+}
@@ -0,0 +1,264 @@
+#include "lint.h"
+#include "level.h"
+#include "solver.h"
+#include "savesdir.h"
+#include "game.h"
+#include "loglib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+typedef struct {
+    int severity;
+    int line;
+    int order;      // keeps report order among diagnostics of one line
+    char *message;
+} LintDiagnostic;
+
+// One level file and what was found in it, only touched by the thread checking it
+typedef struct {
+    char *path;
+    LintDiagnostic *diagnostics;
+    int count;
+    int capacity;
+    int errors;
+    int warnings;
+} LintFile;
+
+static LintFile *lintFiles = NULL;
+static int lintFileCount = 0;
+
+// Next file to check, shared by workers
+#ifdef _WIN32
+static volatile LONG nextLintFile = 0;
+
+static int takeLintFile(void) {
+    return (int)InterlockedIncrement(&nextLintFile) - 1;
+}
+#else
+static pthread_mutex_t lintQueueLock = PTHREAD_MUTEX_INITIALIZER;
+static int nextLintFile = 0;
+
+static int takeLintFile(void) {
+    pthread_mutex_lock(&lintQueueLock);
+    int index = nextLintFile++;
+    pthread_mutex_unlock(&lintQueueLock);
+    return index;
+}
+#endif
+
+// LevelDiagnosticSink collecting into the LintFile given as context.
+static void collectDiagnostic(void *context, int severity, int line, const char *message) {
+    LintFile *file = (LintFile*)context;
+    if (severity == LEVEL_DIAG_ERROR) file->errors++;
+    else file->warnings++;
+    if (file->count == file->capacity) {
+        int capacity = file->capacity ? file->capacity * 2 : 8;
+        LintDiagnostic *grown = (LintDiagnostic*)realloc(file->diagnostics, capacity * sizeof(LintDiagnostic));
+        if (!grown) return; // still counted
+        file->diagnostics = grown;
+        file->capacity = capacity;
+    }
+    LintDiagnostic *diagnostic = &file->diagnostics[file->count];
+    diagnostic->severity = severity;
+    diagnostic->line = line;
+    diagnostic->order = file->count;
+    diagnostic->message = strdup(message);
+    if (diagnostic->message) file->count++;
+}
+
+static int compareDiagnostics(const void *a, const void *b) {
+    const LintDiagnostic *da = (const LintDiagnostic*)a;
+    const LintDiagnostic *db = (const LintDiagnostic*)b;
+    if (da->line != db->line) return (da->line < db->line) ? -1 : 1;
+    return (da->order < db->order) ? -1 : (da->order > db->order);
+}
+
+// Internal: parse one level and check that its goal can be reached.
+static void lintLevel(LintFile *file) {
+    LevelDiagnostics diagnostics = { collectDiagnostic, file };
+    FILE *f = fopen(file->path, "rb");
+    if (!f) {
+        collectDiagnostic(file, LEVEL_DIAG_ERROR, 0, "Failed to open level file.");
+        return;
+    }
+    Level level;
+    int startR, startY, startX;
+    int parsed = parseLevel(f, &level, &startR, &startY, &startX, NULL, &diagnostics);
+    fclose(f);
+    if (!parsed) {
+        freeLevel(&level);
+        return;
+    }
+
+    // Levels without goal are already reported by the parser
+    if (memchr(level.tiles, CHAR_GOAL, LEVEL_SIZE(&level))) {
+        SolverResult result;
+        if (!solveLevel(&level, startR, startY, startX, &result)) {
+            collectDiagnostic(file, LEVEL_DIAG_ERROR, 0, "Solver ran out of memory, goal reachability unknown.");
+        } else if (!result.found) {
+            char message[128];
+            snprintf(message, sizeof(message), "Goal can't be reached from start at (%d, %d) in room %d.", startX, startY, startR);
+            collectDiagnostic(file, LEVEL_DIAG_ERROR, 0, message);
+        }
+        freeSolverResult(&result);
+    }
+    freeLevel(&level);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI lintWorker(LPVOID unused) {
+#else
+static void *lintWorker(void *unused) {
+#endif
+    (void)unused;
+    int index;
+    while ((index = takeLintFile()) < lintFileCount) {
+        lintLevel(&lintFiles[index]);
+    }
+    return 0;
+}
+
+static int addLintFile(const char *path) {
+    LintFile *grown = (LintFile*)realloc(lintFiles, (lintFileCount + 1) * sizeof(LintFile));
+    if (!grown) return 0;
+    lintFiles = grown;
+    memset(&lintFiles[lintFileCount], 0, sizeof(LintFile));
+    lintFiles[lintFileCount].path = strdup(path);
+    if (!lintFiles[lintFileCount].path) return 0;
+    lintFileCount++;
+    return 1;
+}
+
+static int compareLintFiles(const void *a, const void *b) {
+    return strcmp(((const LintFile*)a)->path, ((const LintFile*)b)->path);
+}
+
+static void freeLintFiles(void) {
+    for (int i = 0; i < lintFileCount; i++) {
+        for (int d = 0; d < lintFiles[i].count; d++) free(lintFiles[i].diagnostics[d].message);
+        free(lintFiles[i].diagnostics);
+        free(lintFiles[i].path);
+    }
+    free(lintFiles);
+    lintFiles = NULL;
+    lintFileCount = 0;
+}
+
+static int coreCount(void) {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    return cores > 0 ? (int)cores : 1;
+#endif
+}
+
+// Internal: check files on threadCount threads, the calling thread included.
+static void runLintWorkers(int threadCount) {
+#ifdef _WIN32
+    HANDLE threads[LINT_MAX_THREADS];
+#else
+    pthread_t threads[LINT_MAX_THREADS];
+#endif
+    int started = 0;
+    for (int t = 1; t < threadCount; t++) {
+#ifdef _WIN32
+        threads[started] = CreateThread(NULL, 0, lintWorker, NULL, 0, NULL);
+        if (!threads[started]) break;
+#else
+        if (pthread_create(&threads[started], NULL, lintWorker, NULL) != 0) break;
+#endif
+        started++;
+    }
+    lintWorker(NULL);
+    for (int t = 0; t < started; t++) {
+#ifdef _WIN32
+        WaitForSingleObject(threads[t], INFINITE);
+        CloseHandle(threads[t]);
+#else
+        pthread_join(threads[t], NULL);
+#endif
+    }
+}
+
+// CLI: game.out --lint [-j threads] [level...]
+// Checks given levels, or every level in LEVELS_FOLDER. Diagnostics are printed as
+// <file>:<line>: <severity>: <message>, exit code is 0 if no level has errors.
+int lintCommand(int argc, char **argv) {
+    int threadCount = coreCount();
+    int first = 0;
+    if (argc >= 2 && strcmp(argv[0], "-j") == 0) {
+        threadCount = atoi(argv[1]);
+        first = 2;
+        if (threadCount <= 0) {
+            fprintf(stderr, "Usage: --lint [-j threads] [level...]\n");
+            return 1;
+        }
+    }
+
+    int ok = 1;
+    if (first < argc) {
+        for (int i = first; i < argc && ok; i++) {
+            char levelName[256];
+            char path[512];
+            parseLevelName(argv[i], levelName, sizeof(levelName));
+            snprintf(path, sizeof(path), "%s/%s.dat", LEVELS_FOLDER, levelName);
+            ok = addLintFile(path);
+        }
+    } else {
+        DIR *dir = opendir(LEVELS_FOLDER);
+        if (!dir) {
+            fprintf(stderr, "Failed to open levels directory '%s'.\n", LEVELS_FOLDER);
+            return 1;
+        }
+        struct dirent *entry;
+        while (ok && (entry = readdir(dir)) != NULL) {
+            const char *dot = strrchr(entry->d_name, '.');
+            if (entry->d_name[0] == '.' || !dot || strcmp(dot, ".dat") != 0) continue;
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", LEVELS_FOLDER, entry->d_name);
+            ok = addLintFile(path);
+        }
+        closedir(dir);
+        if (lintFileCount > 1) qsort(lintFiles, lintFileCount, sizeof(LintFile), compareLintFiles);
+    }
+    if (!ok) {
+        fprintf(stderr, "Failed to allocate list of levels.\n");
+        freeLintFiles();
+        return 1;
+    }
+
+    if (threadCount > lintFileCount) threadCount = lintFileCount;
+    if (threadCount > LINT_MAX_THREADS) threadCount = LINT_MAX_THREADS;
+    runLintWorkers(threadCount);
+
+    int errors = 0, warnings = 0, failedFiles = 0;
+    for (int i = 0; i < lintFileCount; i++) {
+        LintFile *file = &lintFiles[i];
+        if (file->count > 1) qsort(file->diagnostics, file->count, sizeof(LintDiagnostic), compareDiagnostics);
+        for (int d = 0; d < file->count; d++) {
+            const LintDiagnostic *diagnostic = &file->diagnostics[d];
+            const char *severity = diagnostic->severity == LEVEL_DIAG_ERROR ? "error" : "warning";
+            if (diagnostic->line > 0) printf("%s:%d: %s: %s\n", file->path, diagnostic->line, severity, diagnostic->message);
+            else printf("%s: %s: %s\n", file->path, severity, diagnostic->message);
+        }
+        errors += file->errors;
+        warnings += file->warnings;
+        if (file->errors) failedFiles++;
+    }
+    printf("%d levels checked, %d with errors, %d errors, %d warnings\n", lintFileCount, failedFiles, errors, warnings);
+    log_info("Lint: %d levels, %d errors, %d warnings", lintFileCount, errors, warnings);
+
+    freeLintFiles();
+    return errors ? 2 : 0;
+}
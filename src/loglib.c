@@ -1,13 +1,52 @@
 #include "loglib.h"
 #include <string.h>
+#include <signal.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <io.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
 
 FILE *loglib_file = NULL;
 time_t loglib_start_time = 0;
 int loglib_initialized = 0;
+int loglib_buffered = 1;
+int loglib_level = LOGLIB_LEVEL_INFO;
+
+// Pending messages, written to the file in one go once a threshold is hit
+static char loglib_buffer[LOGLIB_BUFFER_SIZE];
+static volatile size_t loglib_length = 0; // only grows by whole lines, read by signal handlers
+static time_t loglib_first_pending = 0;  // when the oldest pending message was logged
+static int loglib_fd = -1;               // descriptor of loglib_file, for fatal paths
+
+// Buffer is shared with the flush thread, which writes out messages that waited
+// LOGLIB_FLUSH_SECONDS even when nothing else is logged after them
+#ifdef _WIN32
+static CRITICAL_SECTION loglib_lock;
+static CONDITION_VARIABLE loglib_wake;
+static HANDLE loglib_thread = NULL;
+#define LOGLIB_LOCK() EnterCriticalSection(&loglib_lock)
+#define LOGLIB_UNLOCK() LeaveCriticalSection(&loglib_lock)
+#define LOGLIB_WAKE() WakeConditionVariable(&loglib_wake)
+#else
+static pthread_mutex_t loglib_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t loglib_wake = PTHREAD_COND_INITIALIZER;
+static pthread_t loglib_thread;
+#define LOGLIB_LOCK() pthread_mutex_lock(&loglib_lock)
+#define LOGLIB_UNLOCK() pthread_mutex_unlock(&loglib_lock)
+#define LOGLIB_WAKE() pthread_cond_signal(&loglib_wake)
+#endif
+static int loglib_thread_running = 0;
+static int loglib_stopping = 0;
 
-// Internal: format current time into buffer (localtime).
-static void loglib_now_str(char *buf, size_t bufsz) {
-    time_t t = time(NULL);
+// Timestamp string is only reformatted when the second changes
+static time_t loglib_ts_time = (time_t)-1;
+static char loglib_ts[64];
+
+// Internal: format given time into buffer (localtime).
+static void loglib_time_str(char *buf, size_t bufsz, time_t t) {
     struct tm tm_buf;
     struct tm *tm_ptr = localtime(&t); // portable fallback; copy into local buffer
 
@@ -21,6 +60,15 @@ static void loglib_now_str(char *buf, size_t bufsz) {
     strftime(buf, bufsz, "%Y-%m-%d %H:%M:%S", &tm_buf);
 }
 
+// Internal: cached timestamp of given second.
+static const char *loglib_timestamp(time_t t) {
+    if (t != loglib_ts_time) {
+        loglib_time_str(loglib_ts, sizeof(loglib_ts), t);
+        loglib_ts_time = t;
+    }
+    return loglib_ts;
+}
+
 // Internal: generate log filename based on init time.
 static void loglib_generate_filename(char *buf, size_t bufsz, time_t init_time) {
     struct tm tm_buf;
@@ -35,17 +83,123 @@ static void loglib_generate_filename(char *buf, size_t bufsz, time_t init_time)
     strftime(buf, bufsz, "logs/runtime_%Y-%m-%d_%H-%M-%S.log", &tm_buf);
 }
 
+// Internal: write out pending messages, lock held.
+static void loglib_flush_locked(void) {
+    if (loglib_file && loglib_length) {
+        fwrite(loglib_buffer, 1, loglib_length, loglib_file);
+        fflush(loglib_file);
+    }
+    loglib_length = 0;
+}
+
+// Write out pending messages. Safe to call at any time.
+void log_flush(void) {
+    if (!loglib_initialized) return;
+    LOGLIB_LOCK();
+    loglib_flush_locked();
+    LOGLIB_UNLOCK();
+}
+
+// Write out pending messages from a signal handler, with a single write() and no locks.
+void log_flush_from_signal(void) {
+    size_t length = loglib_length;
+    if (loglib_fd < 0 || !length) return;
+#ifdef _WIN32
+    _write(loglib_fd, loglib_buffer, (unsigned int)length);
+#else
+    ssize_t written = write(loglib_fd, loglib_buffer, length);
+    (void)written; // nothing left to do about a failed write
+#endif
+    loglib_length = 0;
+}
+
+// Internal: flush thread, sleeps until messages are pending and writes them
+// out once the oldest waited LOGLIB_FLUSH_SECONDS.
+#ifdef _WIN32
+static DWORD WINAPI loglib_flusher(LPVOID unused) {
+#else
+static void *loglib_flusher(void *unused) {
+#endif
+    (void)unused;
+    LOGLIB_LOCK();
+    while (!loglib_stopping) {
+        if (!loglib_length) {
+#ifdef _WIN32
+            SleepConditionVariableCS(&loglib_wake, &loglib_lock, INFINITE);
+#else
+            pthread_cond_wait(&loglib_wake, &loglib_lock);
+#endif
+            continue;
+        }
+        time_t due = loglib_first_pending + LOGLIB_FLUSH_SECONDS;
+        time_t now = time(NULL);
+        if (now >= due) {
+            loglib_flush_locked();
+            continue;
+        }
+#ifdef _WIN32
+        SleepConditionVariableCS(&loglib_wake, &loglib_lock, (DWORD)difftime(due, now) * 1000);
+#else
+        struct timespec until = { due, 0 };
+        pthread_cond_timedwait(&loglib_wake, &loglib_lock, &until);
+#endif
+    }
+    LOGLIB_UNLOCK();
+    return 0;
+}
+
+// Internal: start flush thread, without it messages wait for the next log call.
+static void loglib_start_flusher(void) {
+#ifdef _WIN32
+    loglib_thread = CreateThread(NULL, 0, loglib_flusher, NULL, 0, NULL);
+    loglib_thread_running = loglib_thread != NULL;
+#else
+    loglib_thread_running = pthread_create(&loglib_thread, NULL, loglib_flusher, NULL) == 0;
+#endif
+}
+
+static void loglib_stop_flusher(void) {
+    if (!loglib_thread_running) return;
+    LOGLIB_LOCK();
+    loglib_stopping = 1;
+    LOGLIB_WAKE();
+    LOGLIB_UNLOCK();
+#ifdef _WIN32
+    WaitForSingleObject(loglib_thread, INFINITE);
+    CloseHandle(loglib_thread);
+#else
+    pthread_join(loglib_thread, NULL);
+#endif
+    loglib_thread_running = 0;
+}
+
+#ifndef _WIN32
+// Internal: fatal signal before anything else took it over, write out pending messages and die.
+static void loglib_on_signal(int sig) {
+    log_flush_from_signal();
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static void loglib_catch_signals(void) {
+    int signals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGSEGV, SIGABRT };
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        void (*previous)(int) = signal(signals[i], loglib_on_signal);
+        if (previous != SIG_DFL && previous != SIG_ERR) signal(signals[i], previous); // ignored or handled elsewhere
+    }
+}
+#endif
+
 // Close log and write runtime summary. Registered with atexit.
 static void loglib_close(void) {
     if (!loglib_initialized) return;
+    loglib_stop_flusher();
+    log_flush();
     time_t end = time(NULL);
     double seconds = difftime(end, loglib_start_time);
 
-    char ts[64];
-    loglib_now_str(ts, sizeof(ts));
-
     if (loglib_file) {
-        fprintf(loglib_file, "[%s] LOG: shutdown\n", ts);
+        fprintf(loglib_file, "[%s] LOG: shutdown\n", loglib_timestamp(end));
         fprintf(loglib_file, "Runtime: %.0f seconds\n", seconds);
         fflush(loglib_file);
         fclose(loglib_file);
@@ -55,9 +209,20 @@ static void loglib_close(void) {
     loglib_initialized = 0;
 }
 
+// Internal: level from LOGLIB_LEVEL environment variable (info, warn, error, none).
+static void loglib_level_from_env(void) {
+    const char *env = getenv("LOGLIB_LEVEL");
+    if (!env) return;
+    static const char *names[] = { "info", "warn", "error", "none" };
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(env, names[i]) == 0) loglib_level = i;
+    }
+}
+
 // Initialize logging to a given path. Safe to call multiple times.
 void log_start_path(const char *path) {
     if (loglib_initialized) return;
+    loglib_level_from_env();
 
     char filepath[256];
     loglib_start_time = time(NULL);
@@ -74,15 +239,24 @@ void log_start_path(const char *path) {
         loglib_file = fopen(filepath, "w"); // write mode for new file per session
     }
     loglib_initialized = 1;
+#ifdef _WIN32
+    InitializeCriticalSection(&loglib_lock);
+    InitializeConditionVariable(&loglib_wake);
+#endif
 
-    char ts[64];
-    loglib_now_str(ts, sizeof(ts));
     if (loglib_file) {
-        fprintf(loglib_file, "[%s] LOG: start\n", ts);
+        fprintf(loglib_file, "[%s] LOG: start\n", loglib_timestamp(loglib_start_time));
         fflush(loglib_file);
+#ifdef _WIN32
+        loglib_fd = _fileno(loglib_file);
+#else
+        loglib_fd = fileno(loglib_file);
+        loglib_catch_signals();
+#endif
+        loglib_start_flusher();
     }
 
-    // ensure summary is written at program exit
+    // ensure pending messages and summary are written at program exit
     atexit(loglib_close);
 }
 
@@ -91,48 +265,83 @@ void log_start(void) {
     log_start_path(NULL);
 }
 
+// Write every message straight through (0) or batch them (1, default).
+void log_set_buffered(int enabled) {
+    if (!enabled) log_flush();
+    loglib_buffered = enabled;
+}
+
+// Drop messages below level at runtime (LOGLIB_LEVEL_*).
+void log_set_level(int level) {
+    loglib_level = level;
+}
+
 // Lazy init: called by log functions if user didn't call log_start.
 static void loglib_ensure_init(void) {
     if (!loglib_initialized) log_start_path(NULL);
 }
 
-// Core logging function
-static void loglib_logv(const char *level, const char *fmt, va_list ap) {
-    loglib_ensure_init();
+// Internal: format message into the buffer, 0 if it doesn't fit.
+static int loglib_append(const char *ts, const char *name, const char *fmt, va_list ap) {
+    size_t space = LOGLIB_BUFFER_SIZE - loglib_length;
+    char *at = loglib_buffer + loglib_length;
+    int head = snprintf(at, space, "[%s] %s: ", ts, name);
+    if (head < 0 || (size_t)head >= space) return 0;
+    int body = vsnprintf(at + head, space - head, fmt, ap);
+    if (body < 0 || (size_t)(head + body) >= space) return 0; // newline takes place of the terminator
+    at[head + body] = '\n';
+    loglib_length += head + body + 1;
+    return 1;
+}
 
+// Core logging function
+static void loglib_logv(int level, const char *name, const char *fmt, va_list ap) {
     if (!loglib_file) {
         // if file isn't available, do nothing (no console output)
         return;
     }
 
-    char ts[64];
-    loglib_now_str(ts, sizeof(ts));
+    LOGLIB_LOCK();
+    time_t now = time(NULL);
+    const char *ts = loglib_timestamp(now);
+    int wasEmpty = loglib_length == 0;
 
-    // print to file only
-    fprintf(loglib_file, "[%s] %s: ", ts, level);
-    vfprintf(loglib_file, fmt, ap);
-    fprintf(loglib_file, "\n");
-    fflush(loglib_file);
-}
+    va_list retry, direct;
+    va_copy(retry, ap);
+    va_copy(direct, ap);
+    if (!loglib_append(ts, name, fmt, ap)) {
+        loglib_flush_locked();
+        if (!loglib_append(ts, name, fmt, retry)) {
+            // longer than the whole buffer, write it through
+            fprintf(loglib_file, "[%s] %s: ", ts, name);
+            vfprintf(loglib_file, fmt, direct);
+            fprintf(loglib_file, "\n");
+            fflush(loglib_file);
+        }
+    }
+    va_end(direct);
+    va_end(retry);
 
-// Public logging helpers (vararg wrappers)
-void log_info(const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    loglib_logv("INFO", fmt, ap);
-    va_end(ap);
-}
+    if (wasEmpty) loglib_first_pending = now;
 
-void log_warn(const char *fmt, ...) {
-    va_list ap;
-    va_start(ap, fmt);
-    loglib_logv("WARN", fmt, ap);
-    va_end(ap);
+    // Errors are written at once, they may be followed by exit or crash
+    if (!loglib_buffered || level >= LOGLIB_LEVEL_ERROR
+        || loglib_length >= LOGLIB_FLUSH_THRESHOLD
+        || (!loglib_thread_running && difftime(now, loglib_first_pending) >= LOGLIB_FLUSH_SECONDS)) {
+        loglib_flush_locked();
+    } else if (wasEmpty && loglib_length) {
+        LOGLIB_WAKE(); // flush thread waits for the first pending message
+    }
+    LOGLIB_UNLOCK();
 }
 
-void log_error(const char *fmt, ...) {
+// Public logging entry, used through log_info/log_warn/log_error macros
+void loglib_log(int level, const char *fmt, ...) {
+    static const char *names[] = { "INFO", "WARN", "ERROR" };
+    loglib_ensure_init(); // may change loglib_level
+    if (level < loglib_level || level < LOGLIB_LEVEL_INFO || level > LOGLIB_LEVEL_ERROR) return;
     va_list ap;
     va_start(ap, fmt);
-    loglib_logv("ERROR", fmt, ap);
+    loglib_logv(level, names[level], fmt, ap);
     va_end(ap);
 }
@@ -1,4 +1,5 @@
 #include "platform.h"
+#include "loglib.h"
 
 #ifdef _WIN32
 #include <conio.h>
@@ -9,6 +10,13 @@ int usleep(unsigned int usec) {
     return 0;
 }
 
+// Console input is unbuffered already, nothing to switch
+void platform_enter_raw_mode(void) {
+}
+
+void platform_restore_terminal(void) {
+}
+
 char getch_portable(void) {
     return getch();
 }
@@ -29,21 +37,73 @@ void platform_home_cursor(void) {
 
 #include <termios.h>
 #include <unistd.h>
+#include <signal.h>
+#include <errno.h>
 #include <sys/ioctl.h>
 
+// Keys read ahead of the game, everything available is taken in one read()
+#define INPUT_QUEUE_SIZE 256
+
+static struct termios savedTermios;
+static int rawMode = 0;
+static unsigned char inputQueue[INPUT_QUEUE_SIZE];
+static int queueHead = 0;
+static int queueCount = 0;
+
+// Put terminal back as it was, safe to call from a signal handler.
+void platform_restore_terminal(void) {
+    if (!rawMode) return;
+    tcsetattr(STDIN_FILENO, TCSANOW, &savedTermios);
+    rawMode = 0;
+}
+
+static void restoreOnSignal(int sig) {
+    log_flush_from_signal();
+    platform_restore_terminal();
+    static const char showCursor[] = "\033[?25h";
+    write(STDOUT_FILENO, showCursor, sizeof(showCursor) - 1);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// Switch off line buffering and echo for the whole session, undone at exit and on fatal signals.
+void platform_enter_raw_mode(void) {
+    if (rawMode || !isatty(STDIN_FILENO)) return;
+    if (tcgetattr(STDIN_FILENO, &savedTermios) != 0) return;
+    struct termios raw = savedTermios;
+    raw.c_lflag &= ~(ICANON | ECHO);
+    raw.c_cc[VMIN] = 1;
+    raw.c_cc[VTIME] = 0;
+    if (tcsetattr(STDIN_FILENO, TCSANOW, &raw) != 0) return;
+    rawMode = 1;
+
+    atexit(platform_restore_terminal);
+    int signals[] = { SIGINT, SIGTERM, SIGHUP, SIGQUIT, SIGSEGV, SIGABRT };
+    for (size_t i = 0; i < sizeof(signals) / sizeof(signals[0]); i++) {
+        signal(signals[i], restoreOnSignal);
+    }
+}
+
+// Next key from the queue, refilled with everything typed so far once it runs empty.
 char getch_portable(void) {
-    struct termios oldt, newt;
-    char ch;
-    tcgetattr(STDIN_FILENO, &oldt);
-    newt = oldt;
-    newt.c_lflag &= ~(ICANON | ECHO);
-    tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-    ch = getchar();
-    tcsetattr(STDIN_FILENO, TCSANOW, &oldt);
-    return ch;
+    if (queueCount == 0) {
+        fflush(stdout); // prompts without newline must show before waiting
+        ssize_t got;
+        do {
+            got = read(STDIN_FILENO, inputQueue, sizeof(inputQueue));
+        } while (got < 0 && errno == EINTR);
+        if (got <= 0) return (char)EOF;
+        queueHead = 0;
+        queueCount = (int)got;
+    }
+    queueCount--;
+    return (char)inputQueue[queueHead++];
 }
 
+// Drop keys typed ahead, both queued and still in the terminal.
 void flushInput(void) {
+    queueHead = 0;
+    queueCount = 0;
     tcflush(STDIN_FILENO, TCIFLUSH);
 }
 
@@ -0,0 +1,218 @@
+#include "render.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    char glyph[2];
+    const char *color;
+} RenderCell;
+
+// Frame buffers: front is what the terminal shows, back is being composed
+static RenderCell *frontCells = NULL;
+static RenderCell *backCells = NULL;
+static int frameRows = 0;
+static int frameCols = 0;
+static int frontValid = 0; // 0 forces a full redraw on next frame
+static char frontStatus[128];
+static char backStatus[128];
+
+// Bytes of the frame, written to stdout in one go
+static char *outBuffer = NULL;
+static size_t outLength = 0;
+static size_t outCapacity = 0;
+static int outFailed = 0; // frame didn't fit, it is dropped and the next one redraws all
+
+static void outAppend(const char *text, size_t length) {
+    if (outLength + length > outCapacity) {
+        size_t capacity = outCapacity ? outCapacity : 4096;
+        while (capacity < outLength + length) capacity *= 2;
+        char *grown = (char*)realloc(outBuffer, capacity);
+        if (!grown) {
+            outFailed = 1;
+            return;
+        }
+        outBuffer = grown;
+        outCapacity = capacity;
+    }
+    memcpy(outBuffer + outLength, text, length);
+    outLength += length;
+}
+
+static void outString(const char *text) {
+    outAppend(text, strlen(text));
+}
+
+static void outCursor(int row, int col) {
+    char seq[32];
+    int length = snprintf(seq, sizeof(seq), "\033[%d;%dH", row, col);
+    outAppend(seq, (size_t)length);
+}
+
+static int sameColor(const char *a, const char *b) {
+    return a == b || strcmp(a, b) == 0;
+}
+
+static int sameCell(const RenderCell *a, const RenderCell *b) {
+    return a->glyph[0] == b->glyph[0] && a->glyph[1] == b->glyph[1] && sameColor(a->color, b->color);
+}
+
+static void setCell(int row, int col, const char *glyph, const char *color) {
+    RenderCell *cell = &backCells[row * frameCols + col];
+    cell->glyph[0] = glyph[0];
+    cell->glyph[1] = glyph[1];
+    cell->color = color;
+}
+
+// Internal: make sure buffers fit the frame, a new size means full redraw.
+static int prepareFrame(int rows, int cols) {
+    if (rows == frameRows && cols == frameCols && frontCells) return 1;
+    freeRenderer();
+    size_t cells = (size_t)rows * cols;
+    frontCells = (RenderCell*)calloc(cells ? cells : 1, sizeof(RenderCell));
+    backCells = (RenderCell*)calloc(cells ? cells : 1, sizeof(RenderCell));
+    if (!frontCells || !backCells) {
+        freeRenderer();
+        return 0;
+    }
+    frameRows = rows;
+    frameCols = cols;
+    return 1;
+}
+
+// Internal: emit changed status and cells, merging neighbours of the same color.
+static void flushFrame(void) {
+    outLength = 0;
+    outString("\033[?25l"); // hide cursor while drawing
+
+    if (!frontValid || strcmp(frontStatus, backStatus) != 0) {
+        outCursor(1, 1);
+        outString(backStatus);
+    }
+
+    for (int row = 0; row < frameRows; row++) {
+        int col = 0;
+        while (col < frameCols) {
+            int at = row * frameCols + col;
+            if (frontValid && sameCell(&frontCells[at], &backCells[at])) {
+                col++;
+                continue;
+            }
+            outCursor(RENDER_MAP_TOP + row, col * 2 + 1);
+            const char *runColor = NULL;
+            while (col < frameCols) {
+                at = row * frameCols + col;
+                if (frontValid && sameCell(&frontCells[at], &backCells[at])) break;
+                if (!runColor || !sameColor(runColor, backCells[at].color)) {
+                    if (runColor) outString("\x1B[0m");
+                    outString("\x1B[");
+                    outString(backCells[at].color);
+                    outString("m");
+                    runColor = backCells[at].color;
+                }
+                outAppend(backCells[at].glyph, 2);
+                col++;
+            }
+            outString("\x1B[0m");
+        }
+    }
+
+    // Leave cursor under the map, where line by line printing would end
+    outCursor(RENDER_MAP_TOP + frameRows, 1);
+    outString("\033[?25h");
+
+    if (outFailed) {
+        // Nothing of a cut frame is written, it could end inside an escape sequence
+        outFailed = 0;
+        frontValid = 0;
+        return;
+    }
+    fwrite(outBuffer, 1, outLength, stdout);
+    fflush(stdout);
+
+    RenderCell *swap = frontCells;
+    frontCells = backCells;
+    backCells = swap;
+    memcpy(frontStatus, backStatus, sizeof(frontStatus));
+    frontValid = 1;
+}
+
+// Draw the room player is in, only cells that changed since last frame are sent.
+void renderGame(const Level *level, int playerR, int playerY, int playerX, int movesMade, int victory) {
+    if (!prepareFrame(level->width, level->width)) return;
+
+    if (!victory) {
+        snprintf(backStatus, sizeof(backStatus), "Moves made: %d     Position: %2d, %2d, %2d   ", movesMade, playerX, playerY, playerR);
+    } else {
+        snprintf(backStatus, sizeof(backStatus), "Moves made: %d", movesMade); // Position will stay due to lack of redraw
+    }
+
+    for (int i = 0; i < level->width; i++) {
+        for (int j = 0; j < level->width; j++) {
+            if (i == playerY && j == playerX) {
+                setCell(i, j, TILE_PLAYER);
+                continue;
+            }
+            char tile = LEVEL_TILE(level, playerR, i, j);
+            int id = LEVEL_META(level, playerR, i, j);
+            if (id == -2) { // Error
+                setCell(i, j, TILE_ERROR);
+                continue;
+            }
+            switch (tile) {
+                case CHAR_VOID:
+                    setCell(i, j, TILE_VOID);
+                break;
+                case CHAR_WALL:
+                    setCell(i, j, TILE_WALL);
+                break;
+                case CHAR_DOOR:
+                    if (id != -1)// Not open
+                        setCell(i, j, TILE_DOOR);
+                    else
+                        setCell(i, j, TILE_DOOR_RESIDUE);
+                break;
+                case CHAR_KEY:
+                    if (id != -1)// Not collected
+                        setCell(i, j, TILE_KEY);
+                    else
+                        setCell(i, j, TILE_KEY_RESIDUE);
+                break;
+                case CHAR_GOAL:
+                    setCell(i, j, TILE_GOAL);
+                break;
+                case CHAR_PASSAGE:
+                    setCell(i, j, TILE_PASSAGE);
+                break;
+                case CHAR_START:
+                    setCell(i, j, TILE_START_RESIDUE);
+                break;
+                default:;
+                    char symbol[2] = { tile, ' ' };
+                    setCell(i, j, symbol, TILE_SYMBOL_COLOR);
+                break;
+            }
+        }
+    }
+
+    flushFrame();
+}
+
+// Screen was cleared or drawn over, next frame is sent whole.
+void renderInvalidate(void) {
+    frontValid = 0;
+}
+
+void freeRenderer(void) {
+    free(frontCells);
+    free(backCells);
+    free(outBuffer);
+    frontCells = NULL;
+    backCells = NULL;
+    outBuffer = NULL;
+    outLength = 0;
+    outCapacity = 0;
+    frameRows = 0;
+    frameCols = 0;
+    frontValid = 0;
+}
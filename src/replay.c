@@ -0,0 +1,173 @@
+#include "replay.h"
+#include "game.h"
+#include "binio.h"
+#include "loglib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Internal: append to an int list that grows by doubling.
+static int pushInt(int **items, int count, int value) {
+    if (count == 0 || (count >= 8 && (count & (count - 1)) == 0)) {
+        int capacity = count ? count * 2 : 8;
+        int *grown = (int*)realloc(*items, capacity * sizeof(int));
+        if (!grown) return 0;
+        *items = grown;
+    }
+    (*items)[count] = value;
+    return 1;
+}
+
+// Internal: replay count moves numbered from first, out of total. Accepted moves
+// are added to the move sequence of the loaded game if record is set.
+static int replayChunk(GameState *state, int record, const char *moves, int first, int count, int total,
+    ReplayProgress progress, ReplayResult *result) {
+    for (int k = 0; k < count;) {
+        // Runs over plain tiles go in one call, never past the next progress report
+        int run = count - k;
+        if (progress && run > REPLAY_PROGRESS_INTERVAL - (first + k) % REPLAY_PROGRESS_INTERVAL) {
+            run = REPLAY_PROGRESS_INTERVAL - (first + k) % REPLAY_PROGRESS_INTERVAL;
+        }
+        int played = stepPlain(state, moves + k, run);
+        if (played) {
+            result->acceptedCount += played;
+            if (record) addMovesToSequence(moves + k, played);
+            k += played;
+        } else {
+            GameEvents events = step(state, moves[k]);
+            if (events.flags & GAME_EVENT_BLOCKED) {
+                if (!pushInt(&result->rejected, result->rejectedCount, first + k)) return 0;
+                result->rejectedCount++;
+            } else {
+                result->acceptedCount++;
+                if (record) addMovesToSequence(moves + k, 1);
+                if (events.flags & GAME_EVENT_KEY) {
+                    if (!pushInt(&result->keys, result->keyCount, events.id)) return 0;
+                    result->keyCount++;
+                }
+            }
+            k++;
+        }
+        if (progress && ((first + k) % REPLAY_PROGRESS_INTERVAL == 0 || first + k == total)) {
+            progress(first + k, total);
+        }
+    }
+    return 1;
+}
+
+static void finishReplay(const GameState *state, ReplayResult *result) {
+    result->playerX = state->playerX;
+    result->playerY = state->playerY;
+    result->playerR = state->playerR;
+    result->victory = state->victory;
+}
+
+// Internal: replay a mapped save on state. Raw saves are read in place, packed ones
+// are decoded a chunk at a time on the stack.
+static int replayView(GameState *state, int record, const SaveView *view, ReplayProgress progress, ReplayResult *result) {
+    memset(result, 0, sizeof(*result));
+    if (view->encoding == SAVE_ENCODING_RAW) {
+        if (!replayChunk(state, record, (const char*)view->payload, 0, view->count, view->count, progress, result)) return 0;
+        finishReplay(state, result);
+        return 1;
+    }
+    SaveCursor cursor;
+    startSaveCursor(&cursor, view);
+    char chunk[REPLAY_CHUNK_SIZE];
+    int got;
+    while ((got = readSaveMoves(&cursor, chunk, REPLAY_CHUNK_SIZE)) > 0) {
+        if (!replayChunk(state, record, chunk, cursor.index - got, got, view->count, progress, result)) return 0;
+    }
+    if (cursor.index != view->count) {
+        log_error("Save data ends after %d of %d moves.", cursor.index, view->count);
+        return 0;
+    }
+    finishReplay(state, result);
+    return 1;
+}
+
+// Replay moves on top of the loaded game without drawing anything, accepted
+// moves become part of its move sequence.
+int replayMoves(const char *moves, int count, ReplayProgress progress, ReplayResult *result) {
+    memset(result, 0, sizeof(*result));
+    if (!isGameLoaded) return 0;
+    reserveMoves(movesMade + count); // known length, one allocation (grows per move if it fails)
+    if (!replayChunk(&game, 1, moves, 0, count, count, progress, result)) return 0;
+    finishReplay(&game, result);
+    return 1;
+}
+
+// Replay a mapped save on top of the loaded game, same as replayMoves().
+int replaySave(const SaveView *view, ReplayProgress progress, ReplayResult *result) {
+    memset(result, 0, sizeof(*result));
+    if (!isGameLoaded) return 0;
+    reserveMoves(movesMade + view->count);
+    return replayView(&game, 1, view, progress, result);
+}
+
+// Replay a mapped save on any game state, nothing else is touched. States of
+// their own can replay on several threads at once.
+int replayState(GameState *state, const SaveView *view, ReplayResult *result) {
+    return replayView(state, 0, view, NULL, result);
+}
+
+// Replay save file on a state of its own, started like the loaded game before
+// any move. The loaded game is left as it is, so one load serves many saves.
+int replayFile(const char *savePath, ReplayResult *result) {
+    memset(result, 0, sizeof(*result));
+    if (!isGameLoaded) return 0;
+    SaveView view;
+    if (!openSaveView(savePath, &view)) {
+        log_error("Failed to load game data from file '%s'.", savePath);
+        return 0;
+    }
+    if (view.levelHash && view.levelHash != loadedLevelHash) {
+        log_warn("Save file '%s' was made on a different version of level %s.", savePath, loadedLevelName);
+    }
+    GameState state;
+    if (!startGameState(&state)) {
+        log_error("Failed to allocate game state to replay '%s'.", savePath);
+        closeSaveView(&view);
+        return 0;
+    }
+    int ok = replayState(&state, &view, result);
+    freeGameState(&state);
+    closeSaveView(&view);
+    return ok;
+}
+
+void freeReplayResult(ReplayResult *result) {
+    free(result->rejected);
+    free(result->keys);
+    memset(result, 0, sizeof(*result));
+}
+
+// CLI: game.out --replay <level> <save.bin>...
+// Prints one line per save, exit code is 0 if every save replayed without rejected moves.
+int replayCommand(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: --replay <level> <save.bin>...\n");
+        return 1;
+    }
+
+    char levelName[256];
+    parseLevelName(argv[0], levelName, sizeof(levelName));
+
+    int loaded = loadGame(levelName); // once for all saves, each replays on its own state
+    int failures = 0;
+    for (int i = 1; i < argc; i++) {
+        ReplayResult result;
+        if (!loaded || !replayFile(argv[i], &result)) {
+            printf("%s: error\n", argv[i]);
+            failures++;
+            continue;
+        }
+        printf("%s: %s accepted=%d rejected=%d victory=%d room=%d x=%d y=%d keys=%d\n",
+            argv[i], result.rejectedCount ? "invalid" : "ok", result.acceptedCount, result.rejectedCount,
+            result.victory, result.playerR, result.playerX, result.playerY, result.keyCount);
+        if (result.rejectedCount) failures++;
+        freeReplayResult(&result);
+    }
+    if (loaded) unloadGame();
+    return failures ? 2 : 0;
+}
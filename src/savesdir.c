@@ -2,11 +2,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
 #include "binio.h"
 #include "savesdir.h"
 #include "loglib.h"
 
 int localDataLoaded = 0;
+int localDataVersion = 0; // bumped on every change, lets views know to rebuild
 int levelCount = 0;
 char** levelNames = NULL;
 int* finishedGameCounts = NULL;
@@ -15,6 +18,21 @@ int** finishedMovesCounts = NULL;
 int* ongoingGameCounts = NULL;
 char*** ongoingPlayerNames = NULL;
 
+// Directory modification times seen by last scan, 0 if directory was missing
+static time_t levelsFolderTime = 0;
+static time_t* finishedFolderTimes = NULL;
+static time_t* ongoingFolderTimes = NULL;
+
+static time_t folderTime(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return 0;
+    return st.st_mtime;
+}
+
+static void levelFolderPath(char *buf, size_t bufsz, int levelIndex, int finished) {
+    snprintf(buf, bufsz, GAMES_FOLDER"/%s/%s/", levelNames[levelIndex], finished ? FINISHED_FOLDER : ONGOING_FOLDER);
+}
+
 void freeLocalData(void) {
     if (!localDataLoaded) return;
 
@@ -82,6 +100,11 @@ void freeLocalData(void) {
         ongoingGameCounts = NULL;
     }
 
+    free(finishedFolderTimes);
+    finishedFolderTimes = NULL;
+    free(ongoingFolderTimes);
+    ongoingFolderTimes = NULL;
+
     localDataLoaded = 0;
     levelCount = 0;
 }
@@ -91,11 +114,13 @@ void fetchLocalData(void) {
         freeLocalData();
     }
 
+    levelsFolderTime = folderTime(LEVELS_FOLDER);
     DIR *dir = opendir(LEVELS_FOLDER);
     if (!dir) {
         log_error("Failed to open levels directory '%s'.", LEVELS_FOLDER);
         levelCount = 0;
         localDataLoaded = 1;
+        localDataVersion++;
         return;
     }
 
@@ -116,6 +141,8 @@ void fetchLocalData(void) {
     finishedMovesCounts = calloc(levelCount, sizeof(int*));
     ongoingGameCounts = calloc(levelCount, sizeof(int));
     ongoingPlayerNames = calloc(levelCount, sizeof(char**));
+    finishedFolderTimes = calloc(levelCount, sizeof(time_t));
+    ongoingFolderTimes = calloc(levelCount, sizeof(time_t));
 
     dir = opendir(LEVELS_FOLDER);
     int idx = 0;
@@ -131,6 +158,7 @@ void fetchLocalData(void) {
         char finishedPath[256];
         sprintf(finishedPath, GAMES_FOLDER"/%s/"FINISHED_FOLDER"/", name);
 
+        finishedFolderTimes[idx] = folderTime(finishedPath);
         DIR *fdir = opendir(finishedPath);
         if (fdir) {
             int fcount = 0;
@@ -145,10 +173,18 @@ void fetchLocalData(void) {
             finishedPlayerNames[idx] = calloc(fcount, sizeof(char*));
             finishedMovesCounts[idx] = calloc(fcount, sizeof(int));
 
+            // Move counts come from the directory index, saves are only opened when missing from it
+            SaveIndexEntry *indexed = NULL;
+            int indexedCount = 0;
+            int indexRead = isSaveIndexFresh(finishedPath) ? readSaveIndex(finishedPath, &indexed, &indexedCount) : 0;
+            int indexDirty = indexRead != 1; // missing, stale or holding repeated names
+            SaveIndexEntry *rebuilt = calloc(fcount ? fcount : 1, sizeof(SaveIndexEntry));
+
             fdir = opendir(finishedPath);
             int fidx = 0;
             while ((fentry = readdir(fdir)) != NULL) {
                 if (fentry->d_name[0] == '.') continue;
+                if (fidx >= fcount) break; // directory grew since counting
 
                 char* saveName = strdup(fentry->d_name);
                 char* dot = strrchr(saveName, '.');
@@ -156,27 +192,46 @@ void fetchLocalData(void) {
 
                 finishedPlayerNames[idx][fidx] = saveName;
 
-                char fullPath[261]; // 256 + 5
-                sprintf(fullPath, "%s/%s.bin", finishedPath, saveName);
-
                 int loadedMoves;
-                char* loadedSeq;
-                if (loadData(fullPath, &loadedMoves, &loadedSeq)) {
-                    finishedMovesCounts[idx][fidx] = loadedMoves;
-                    free(loadedSeq);
+                const SaveIndexEntry *known = findSaveIndex(indexed, indexedCount, fentry->d_name);
+                if (known) {
+                    loadedMoves = known->count;
                 } else {
-                    finishedMovesCounts[idx][fidx] = -1;
-                    log_error("Failed to load moves for %s", fullPath);
+                    indexDirty = 1;
+                    char fullPath[512];
+                    sprintf(fullPath, "%s%s", finishedPath, fentry->d_name);
+                    if (!peekData(fullPath, &loadedMoves)) {
+                        loadedMoves = -1;
+                        log_error("Failed to load moves for %s", fullPath);
+                    }
+                }
+                finishedMovesCounts[idx][fidx] = loadedMoves;
+                if (rebuilt && loadedMoves >= 0) {
+                    rebuilt[fidx].name = strdup(fentry->d_name);
+                    rebuilt[fidx].count = loadedMoves;
                 }
 
                 fidx++;
             }
             closedir(fdir);
+
+            // Missing or stale index is rewritten from what was found
+            int rebuiltCount = fidx;
+            if (indexDirty && rebuilt) {
+                rebuiltCount = 0;
+                for (int i = 0; i < fidx; i++) {
+                    if (rebuilt[i].name) rebuilt[rebuiltCount++] = rebuilt[i];
+                }
+                writeSaveIndex(finishedPath, rebuilt, rebuiltCount);
+            }
+            freeSaveIndex(rebuilt, rebuiltCount);
+            freeSaveIndex(indexed, indexedCount);
         }
 
         char ongoingPath[256];
         sprintf(ongoingPath, GAMES_FOLDER"/%s/"ONGOING_FOLDER"/", name);
 
+        ongoingFolderTimes[idx] = folderTime(ongoingPath);
         DIR *odir = opendir(ongoingPath);
         if (odir) {
             int ocount = 0;
@@ -202,17 +257,6 @@ void fetchLocalData(void) {
 
                 ongoingPlayerNames[idx][oidx] = saveName;
 
-                char fullPath[261]; // 256 + 5
-                sprintf(fullPath, "%s/%s.bin", ongoingPath, saveName);
-
-                int loadedMoves;
-                char* loadedSeq;
-                if (loadData(fullPath, &loadedMoves, &loadedSeq)) {
-                    free(loadedSeq);
-                } else {
-                    log_error("Failed to load moves for %s", fullPath);
-                }
-
                 oidx++;
             }
 
@@ -224,4 +268,106 @@ void fetchLocalData(void) {
 
     closedir(dir);
     localDataLoaded = 1;
+    localDataVersion++;
+}
+
+// Internal: position of player in list, -1 if not there.
+static int findPlayer(char **names, int count, const char *playerName) {
+    for (int i = 0; i < count; i++) {
+        if (names[i] && strcmp(names[i], playerName) == 0) return i;
+    }
+    return -1;
+}
+
+// Position of level in levelNames, -1 if not there.
+int findLevelIndex(const char *levelName) {
+    for (int i = 0; i < levelCount; i++) {
+        if (levelNames[i] && strcmp(levelNames[i], levelName) == 0) return i;
+    }
+    return -1;
+}
+
+// Internal: record finished save in the index of its folder. Saves made again
+// leave a repeated name behind, the index is then rewritten without it.
+static void indexFinishedSave(const char *levelName, const char *playerName, int movesCount) {
+    char dirPath[256];
+    char fileName[256];
+    snprintf(dirPath, sizeof(dirPath), GAMES_FOLDER"/%s/"FINISHED_FOLDER"/", levelName);
+    snprintf(fileName, sizeof(fileName), "%s.bin", playerName);
+    if (!appendSaveIndex(dirPath, fileName, movesCount)) return;
+
+    SaveIndexEntry *entries = NULL;
+    int count = 0;
+    if (readSaveIndex(dirPath, &entries, &count) == 2) writeSaveIndex(dirPath, entries, count);
+    freeSaveIndex(entries, count);
+}
+
+// Add or update one save in place, after it was written by saveData.
+// Falls back to full scan for levels that weren't known yet.
+void updateLocalData(const char *levelName, const char *playerName, int finished, int movesCount) {
+    if (finished) indexFinishedSave(levelName, playerName, movesCount);
+    int idx = localDataLoaded ? findLevelIndex(levelName) : -1;
+    if (idx < 0) {
+        fetchLocalData();
+        return;
+    }
+
+    int *counts = finished ? finishedGameCounts : ongoingGameCounts;
+    char ***names = finished ? finishedPlayerNames : ongoingPlayerNames;
+    int at = findPlayer(names[idx], counts[idx], playerName);
+    if (at < 0) {
+        char *name = strdup(playerName);
+        char **grownNames = realloc(names[idx], (counts[idx] + 1) * sizeof(char*));
+        if (grownNames) names[idx] = grownNames;
+        int grownOk = grownNames != NULL;
+        if (finished && grownOk) {
+            int *grownMoves = realloc(finishedMovesCounts[idx], (counts[idx] + 1) * sizeof(int));
+            if (grownMoves) finishedMovesCounts[idx] = grownMoves;
+            grownOk = grownMoves != NULL;
+        }
+        if (!name || !grownOk) {
+            free(name);
+            log_error("Failed to add %s to local data, rescanning.", playerName);
+            fetchLocalData();
+            return;
+        }
+        at = counts[idx]++;
+        names[idx][at] = name;
+    }
+    if (finished) finishedMovesCounts[idx][at] = movesCount;
+    localDataVersion++;
+
+    // Our own write changed the folder, don't mistake it for outside change
+    char path[256];
+    levelFolderPath(path, sizeof(path), idx, finished);
+    time_t *times = finished ? finishedFolderTimes : ongoingFolderTimes;
+    times[idx] = folderTime(path);
+}
+
+// Record folder time after the game changed a folder without touching listed
+// saves (e.g. the autosave journal), so it isn't taken for an outside change.
+void noteLocalFolderChange(const char *levelName, int finished) {
+    int idx = localDataLoaded ? findLevelIndex(levelName) : -1;
+    if (idx < 0) return;
+    char path[256];
+    levelFolderPath(path, sizeof(path), idx, finished);
+    time_t *times = finished ? finishedFolderTimes : ongoingFolderTimes;
+    times[idx] = folderTime(path);
+}
+
+// Rescan only if levels or save folders changed on disk since last scan.
+// Returns 1 if a rescan happened.
+int refreshLocalData(void) {
+    int changed = !localDataLoaded || folderTime(LEVELS_FOLDER) != levelsFolderTime;
+    for (int i = 0; i < levelCount && !changed; i++) {
+        char path[256];
+        levelFolderPath(path, sizeof(path), i, 1);
+        if (folderTime(path) != finishedFolderTimes[i]) changed = 1;
+        levelFolderPath(path, sizeof(path), i, 0);
+        if (folderTime(path) != ongoingFolderTimes[i]) changed = 1;
+    }
+    if (!changed) return 0;
+    log_info("Saves changed on disk, rescanning.");
+    fetchLocalData();
+    return 1;
 }
@@ -0,0 +1,355 @@
+#include "solver.h"
+#include "game.h"
+#include "gamestate.h"
+#include "binio.h"
+#include "loglib.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+// Distinct sets of collected keys, each set is a bitset of `words` words.
+// States refer to a set by index so the bitset is stored once.
+typedef struct {
+    int words;
+    int count;
+    int capacity;
+    uint64_t *bits;
+    int *table;     // open addressing, index into bits or -1
+    size_t mask;
+} KeySets;
+
+// Visited (position, key set) pairs, packed as keySet * cells + cell.
+// Stored + 1 so that 0 marks an empty slot.
+typedef struct {
+    uint64_t *slots;
+    size_t mask;
+    size_t count;
+} StateSet;
+
+// Every state ever queued, in BFS order. The queue is the array itself.
+typedef struct {
+    size_t *cells;
+    int *keySets;
+    int *parents;
+    char *moves;
+    int count;
+    int capacity;
+} StateList;
+
+static uint64_t hashWord(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x;
+}
+
+static uint64_t hashBits(const uint64_t *bits, int words) {
+    uint64_t h = 0x9e3779b97f4a7c15ULL;
+    for (int i = 0; i < words; i++) h = hashWord(h ^ bits[i]);
+    return h;
+}
+
+static int initKeySets(KeySets *sets, int keyCount) {
+    memset(sets, 0, sizeof(*sets));
+    sets->words = keyCount > 0 ? (keyCount + 63) / 64 : 1;
+    sets->mask = 63;
+    sets->table = (int*)malloc((sets->mask + 1) * sizeof(int));
+    if (!sets->table) return 0;
+    for (size_t i = 0; i <= sets->mask; i++) sets->table[i] = -1;
+    return 1;
+}
+
+static void freeKeySets(KeySets *sets) {
+    free(sets->bits);
+    free(sets->table);
+    memset(sets, 0, sizeof(*sets));
+}
+
+static int growKeySetTable(KeySets *sets) {
+    size_t size = (sets->mask + 1) * 2;
+    int *table = (int*)malloc(size * sizeof(int));
+    if (!table) return 0;
+    for (size_t i = 0; i < size; i++) table[i] = -1;
+    for (int k = 0; k < sets->count; k++) {
+        size_t slot = hashBits(sets->bits + (size_t)k * sets->words, sets->words) & (size - 1);
+        while (table[slot] != -1) slot = (slot + 1) & (size - 1);
+        table[slot] = k;
+    }
+    free(sets->table);
+    sets->table = table;
+    sets->mask = size - 1;
+    return 1;
+}
+
+// Index of given key set, added if not seen before. -1 when out of memory.
+static int internKeySet(KeySets *sets, const uint64_t *bits) {
+    size_t slot = hashBits(bits, sets->words) & sets->mask;
+    while (sets->table[slot] != -1) {
+        int k = sets->table[slot];
+        if (memcmp(sets->bits + (size_t)k * sets->words, bits, sets->words * sizeof(uint64_t)) == 0) return k;
+        slot = (slot + 1) & sets->mask;
+    }
+
+    if (sets->count == sets->capacity) {
+        int capacity = sets->capacity ? sets->capacity * 2 : 16;
+        uint64_t *grown = (uint64_t*)realloc(sets->bits, (size_t)capacity * sets->words * sizeof(uint64_t));
+        if (!grown) return -1;
+        sets->bits = grown;
+        sets->capacity = capacity;
+    }
+    int k = sets->count++;
+    memcpy(sets->bits + (size_t)k * sets->words, bits, sets->words * sizeof(uint64_t));
+    sets->table[slot] = k;
+
+    if ((size_t)sets->count * 2 > sets->mask + 1 && !growKeySetTable(sets)) return -1;
+    return k;
+}
+
+static int initStateSet(StateSet *set) {
+    set->count = 0;
+    set->mask = 1023;
+    set->slots = (uint64_t*)calloc(set->mask + 1, sizeof(uint64_t));
+    return set->slots != NULL;
+}
+
+static int growStateSet(StateSet *set) {
+    size_t size = (set->mask + 1) * 2;
+    uint64_t *slots = (uint64_t*)calloc(size, sizeof(uint64_t));
+    if (!slots) return 0;
+    for (size_t i = 0; i <= set->mask; i++) {
+        if (!set->slots[i]) continue;
+        size_t slot = hashWord(set->slots[i]) & (size - 1);
+        while (slots[slot]) slot = (slot + 1) & (size - 1);
+        slots[slot] = set->slots[i];
+    }
+    free(set->slots);
+    set->slots = slots;
+    set->mask = size - 1;
+    return 1;
+}
+
+// 1 if state was added, 0 if already visited, -1 when out of memory.
+static int visitState(StateSet *set, uint64_t state) {
+    uint64_t key = state + 1;
+    size_t slot = hashWord(key) & set->mask;
+    while (set->slots[slot]) {
+        if (set->slots[slot] == key) return 0;
+        slot = (slot + 1) & set->mask;
+    }
+    set->slots[slot] = key;
+    set->count++;
+    if (set->count * 2 > set->mask + 1 && !growStateSet(set)) return -1;
+    return 1;
+}
+
+static int pushState(StateList *list, size_t cell, int keySet, int parent, char move) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 1024;
+        size_t *cells = (size_t*)realloc(list->cells, capacity * sizeof(size_t));
+        if (cells) list->cells = cells;
+        int *keySets = (int*)realloc(list->keySets, capacity * sizeof(int));
+        if (keySets) list->keySets = keySets;
+        int *parents = (int*)realloc(list->parents, capacity * sizeof(int));
+        if (parents) list->parents = parents;
+        char *moves = (char*)realloc(list->moves, capacity * sizeof(char));
+        if (moves) list->moves = moves;
+        if (!cells || !keySets || !parents || !moves) return 0;
+        list->capacity = capacity;
+    }
+    list->cells[list->count] = cell;
+    list->keySets[list->count] = keySet;
+    list->parents[list->count] = parent;
+    list->moves[list->count] = move;
+    list->count++;
+    return 1;
+}
+
+static void freeStateList(StateList *list) {
+    free(list->cells);
+    free(list->keySets);
+    free(list->parents);
+    free(list->moves);
+    memset(list, 0, sizeof(*list));
+}
+
+// Breadth first search over (room, y, x, collected keys), following the rules of
+// step(). Tiles outside of room count as walls.
+int solveLevel(const Level *level, int startR, int startY, int startX, SolverResult *result) {
+    memset(result, 0, sizeof(*result));
+    clock_t started = clock();
+
+    int width = level->width;
+    size_t roomSize = LEVEL_ROOM_SIZE(level);
+    size_t cellCount = LEVEL_SIZE(level);
+
+    // Only keys that open at least one door are worth a bit
+    int keyGroups = level->keys.groupCount;
+    int *keyBits = (int*)malloc((keyGroups ? keyGroups : 1) * sizeof(int));
+    if (!keyBits) return 0;
+    int bitCount = 0;
+    for (int g = 0; g < keyGroups; g++) {
+        int id = level->keys.ids[g];
+        keyBits[g] = (id != -1 && findIdGroupIndex(&level->doors, id) >= 0) ? bitCount++ : -1;
+    }
+
+    KeySets sets = {0};
+    StateSet visited = {0};
+    StateList states = {0};
+    int ok = 0;
+    int goalState = -1;
+    uint64_t *scratch = NULL;
+    if (!initKeySets(&sets, bitCount) || !initStateSet(&visited)) goto done;
+    scratch = (uint64_t*)calloc(sets.words, sizeof(uint64_t));
+    if (!scratch) goto done;
+
+    size_t start = LEVEL_INDEX(level, startR, startY, startX);
+    int emptySet = internKeySet(&sets, scratch);
+    if (emptySet < 0 || visitState(&visited, (uint64_t)emptySet * cellCount + start) < 0) goto done;
+    if (!pushState(&states, start, emptySet, -1, 0)) goto done;
+
+    static const char dirMoves[4] = { 'w', 's', 'a', 'd' };
+    static const int dirY[4] = { -1, 1, 0, 0 };
+    static const int dirX[4] = { 0, 0, -1, 1 };
+
+    for (int head = 0; head < states.count && goalState < 0; head++) {
+        result->expanded++;
+        size_t cell = states.cells[head];
+        int keySet = states.keySets[head];
+        const uint64_t *have = sets.bits + (size_t)keySet * sets.words;
+        int y = (int)(cell % roomSize / width);
+        int x = (int)(cell % width);
+
+        for (int d = 0; d < 4; d++) {
+            int ny = y + dirY[d];
+            int nx = x + dirX[d];
+            if (ny < 0 || ny >= width || nx < 0 || nx >= width) continue;
+            size_t next = cell - (size_t)y * width - x + (size_t)ny * width + nx;
+            char tile = level->tiles[next];
+            int id = level->meta[next];
+
+            if (tile == CHAR_WALL) continue;
+            if (tile == CHAR_DOOR && id != -1) {
+                int g = (id != -2) ? findIdGroupIndex(&level->keys, id) : -1;
+                int bit = (g >= 0) ? keyBits[g] : -1;
+                if (bit < 0 || !(have[bit / 64] & (1ULL << (bit % 64)))) continue;
+            }
+
+            int nextSet = keySet;
+            int reachedGoal = 0;
+            if (id != -2) {
+                if (tile == CHAR_GOAL) {
+                    reachedGoal = 1;
+                } else if (tile == CHAR_KEY && id != -1) {
+                    int g = findIdGroupIndex(&level->keys, id);
+                    int bit = (g >= 0) ? keyBits[g] : -1;
+                    if (bit >= 0 && !(have[bit / 64] & (1ULL << (bit % 64)))) {
+                        memcpy(scratch, have, sets.words * sizeof(uint64_t));
+                        scratch[bit / 64] |= 1ULL << (bit % 64);
+                        nextSet = internKeySet(&sets, scratch);
+                        if (nextSet < 0) goto done;
+                        have = sets.bits + (size_t)keySet * sets.words; // bits may have moved
+                    }
+                } else if (tile == CHAR_PASSAGE) {
+                    size_t other;
+                    if (findPassageExit(level, id, next, &other)) next = other;
+                }
+            }
+
+            int added = visitState(&visited, (uint64_t)nextSet * cellCount + next);
+            if (added < 0) goto done;
+            if (!added) continue;
+            if (!pushState(&states, next, nextSet, head, dirMoves[d])) goto done;
+            if (reachedGoal) {
+                goalState = states.count - 1;
+                break;
+            }
+        }
+    }
+    ok = 1;
+
+    if (goalState >= 0) {
+        int length = 0;
+        for (int s = goalState; states.parents[s] >= 0; s = states.parents[s]) length++;
+        result->moves = (char*)malloc(length ? length : 1);
+        if (!result->moves) {
+            ok = 0;
+            goto done;
+        }
+        int i = length;
+        for (int s = goalState; states.parents[s] >= 0; s = states.parents[s]) result->moves[--i] = states.moves[s];
+        result->moveCount = length;
+        result->found = 1;
+    }
+
+done:
+    result->visited = (long long)visited.count;
+    result->seconds = (double)(clock() - started) / CLOCKS_PER_SEC;
+    free(scratch);
+    free(keyBits);
+    freeKeySets(&sets);
+    free(visited.slots);
+    freeStateList(&states);
+    return ok;
+}
+
+void freeSolverResult(SolverResult *result) {
+    free(result->moves);
+    memset(result, 0, sizeof(*result));
+}
+
+// CLI: game.out --solve <level> [out.bin]
+// Without output file the moves are printed. Exit code 0 if solved, 2 if unsolvable.
+int solveCommand(int argc, char **argv) {
+    if (argc < 1) {
+        fprintf(stderr, "Usage: --solve <level> [out.bin]\n");
+        return 1;
+    }
+
+    char levelName[256];
+    parseLevelName(argv[0], levelName, sizeof(levelName));
+
+    if (!loadGame(levelName)) {
+        fprintf(stderr, "Failed to load level '%s'.\n", levelName);
+        return 1;
+    }
+    SolverResult result;
+    int ok = solveLevel(&level, game.playerR, game.playerY, game.playerX, &result);
+    uint32_t levelHash = loadedLevelHash;
+    // Search keeps collected keys instead of level state, play the path for real to be sure
+    int verified = 1;
+    if (ok && result.found) {
+        for (int i = 0; i < result.moveCount; i++) step(&game, result.moves[i]);
+        verified = game.victory;
+    }
+    unloadGame();
+    if (!ok) {
+        log_error("Solver ran out of memory after %lld states.", result.visited);
+        fprintf(stderr, "Solver failed, see log.\n");
+        return 1;
+    }
+
+    double rate = result.seconds > 0 ? result.expanded / result.seconds : 0;
+    printf("%s: %s moves=%d expanded=%lld visited=%lld time=%.3fs rate=%.0f nodes/s\n",
+        levelName, result.found ? "solved" : "unsolvable", result.moveCount,
+        result.expanded, result.visited, result.seconds, rate);
+    log_info("Solver on %s: %d moves, %lld nodes expanded (%.0f nodes/s)", levelName, result.moveCount, result.expanded, rate);
+
+    int status = result.found ? 0 : 2;
+    if (!verified) {
+        log_error("Solution of %s doesn't reach the goal when played.", levelName);
+        fprintf(stderr, "Solution doesn't reach the goal when played, see log.\n");
+        status = 1;
+    } else if (result.found) {
+        if (argc > 1) {
+            if (!saveData(argv[1], result.moveCount, result.moves, levelHash)) status = 1;
+        } else {
+            printf("%.*s\n", result.moveCount, result.moves);
+        }
+    }
+    freeSolverResult(&result);
+    return status;
+}